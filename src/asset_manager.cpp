@@ -0,0 +1,390 @@
+#include "asset_manager.h"
+#include "asset_pack.h"
+
+template <typename T>
+uint32_t AssetManager::Pool<T>::allocate(const std::string& path, const T& asset)
+{
+    uint32_t index;
+    if (!free.empty()) {
+        index = free.back();
+        free.pop_back();
+    } else {
+        index = (uint32_t)slots.size();
+        slots.emplace_back();
+    }
+
+    Slot<T>& slot = slots[index];
+    slot.path = path;
+    slot.asset = asset;
+    slot.refs = 1;
+    by_path[path] = index;
+    live++;
+    return index;
+}
+
+template <typename T>
+bool AssetManager::Pool<T>::release(uint32_t index, uint32_t generation)
+{
+    Slot<T>* slot = get(index, generation);
+    if (!slot || --slot->refs > 0)
+        return false;
+
+    by_path.erase(slot->path);
+    slot->path.clear();
+    slot->generation++;
+    if (slot->generation == 0)
+        slot->generation = 1;
+    free.push_back(index);
+    live--;
+    return true;
+}
+
+template <typename Handle, typename T>
+Handle AssetManager::find(const Pool<T>& pool, const std::string& path)
+{
+    auto it = pool.by_path.find(path);
+    if (it == pool.by_path.end())
+        return {};
+    return { it->second, pool.slots[it->second].generation };
+}
+
+TextureHandle AssetManager::find_texture(const std::string& path) const
+{
+    return find<TextureHandle>(textures, path);
+}
+
+TextureHandle AssetManager::allocate_texture(const std::string& path)
+{
+    uint32_t index = textures.allocate(path, AtlasSprite {});
+    if (index >= residency.size())
+        residency.resize(index + 1);
+    residency[index] = Residency {};
+    textures.slots[index].asset = placeholder(residency[index].width, residency[index].height);
+    return { index, textures.slots[index].generation };
+}
+
+TextureHandle AssetManager::load_texture(const std::string& path)
+{
+    TextureHandle handle = find_texture(path);
+    if (handle.valid()) {
+        acquire(handle);
+        return handle;
+    }
+
+    // Nothing is read until the texture is first drawn
+    return allocate_texture(path);
+}
+
+TextureHandle AssetManager::add_texture(const std::string& path, Image& image)
+{
+    TextureHandle handle = find_texture(path);
+    if (handle.valid()) {
+        acquire(handle);
+        if (residency[handle.index].resident)
+            return handle;
+    }
+
+    AtlasSprite sprite = texture_atlas.add(image);
+    if (!sprite.valid()) {
+        TraceLog(LOG_WARNING, "Failed to pack texture into atlas: %s", path.c_str());
+        return handle;
+    }
+
+    if (!handle.valid())
+        handle = allocate_texture(path);
+    make_resident(handle.index, sprite);
+    residency[handle.index].last_used = frame;
+    return handle;
+}
+
+void AssetManager::make_resident(uint32_t index, const AtlasSprite& sprite)
+{
+    Residency& r = residency[index];
+    r.resident = true;
+    r.requested = false;
+    r.loading = false;
+    r.width = sprite.width();
+    r.height = sprite.height();
+
+    textures.slots[index].asset = sprite;
+    counters.resident++;
+    counters.resident_bytes += (size_t)r.width * r.height * 4;
+    counters.loads++;
+    epoch++;
+}
+
+void AssetManager::evict(uint32_t index)
+{
+    Residency& r = residency[index];
+    if (!r.resident)
+        return;
+
+    texture_atlas.remove(textures.slots[index].asset);
+    textures.slots[index].asset = placeholder(r.width, r.height);
+    r.resident = false;
+    counters.resident--;
+    counters.resident_bytes -= (size_t)r.width * r.height * 4;
+    counters.evictions++;
+}
+
+AtlasSprite AssetManager::placeholder(int width, int height) const
+{
+    // The checker texture repeats, so a rect of the real size keeps tile and frame math intact
+    AtlasSprite sprite;
+    sprite.texture = placeholder_texture;
+    sprite.rect = { 0, 0, (float)width, (float)height };
+    sprite.page = placeholder_texture.id != 0 ? PLACEHOLDER_PAGE : -1;
+    return sprite;
+}
+
+void AssetManager::acquire(TextureHandle handle)
+{
+    if (auto* slot = textures.get(handle.index, handle.generation))
+        slot->refs++;
+}
+
+void AssetManager::release(TextureHandle& handle)
+{
+    if (!shut_down && textures.get(handle.index, handle.generation)) {
+        bool wasResident = residency[handle.index].resident;
+        AtlasSprite sprite = textures.slots[handle.index].asset;
+        if (textures.release(handle.index, handle.generation) && wasResident) {
+            Residency& r = residency[handle.index];
+            texture_atlas.remove(sprite);
+            counters.resident--;
+            counters.resident_bytes -= (size_t)r.width * r.height * 4;
+            r = Residency {};
+        }
+    }
+    handle = {};
+}
+
+const AtlasSprite& AssetManager::sprite(TextureHandle handle) const
+{
+    static const AtlasSprite empty;
+    const auto* slot = textures.get(handle.index, handle.generation);
+    if (!slot)
+        return empty;
+
+    Residency& r = residency[handle.index];
+    r.last_used = frame;
+    if (r.resident) {
+        counters.hits++;
+    } else if (!r.requested && !r.failed) {
+        r.requested = true;
+        counters.misses++;
+    }
+    return slot->asset;
+}
+
+const std::string& AssetManager::path(TextureHandle handle) const
+{
+    static const std::string none;
+    const auto* slot = textures.get(handle.index, handle.generation);
+    return slot ? slot->path : none;
+}
+
+int AssetManager::refs(TextureHandle handle) const
+{
+    const auto* slot = textures.get(handle.index, handle.generation);
+    return slot ? slot->refs : 0;
+}
+
+bool AssetManager::resident(TextureHandle handle) const
+{
+    return textures.get(handle.index, handle.generation) && residency[handle.index].resident;
+}
+
+bool AssetManager::reload(const std::string& path)
+{
+    TextureHandle handle = find_texture(path);
+    if (shut_down || !handle.valid())
+        return false;
+
+    Residency& r = residency[handle.index];
+    r.failed = false; // it may decode now
+    if (!r.resident)
+        return true;
+
+    if (!loader)
+        loader = std::make_unique<ImageLoader>();
+    loader->request(path, [this, handle, path](Image& image) {
+        // Released or evicted meanwhile, an evicted one reads the new file when it comes back
+        if (!textures.get(handle.index, handle.generation) || !residency[handle.index].resident)
+            return;
+
+        AtlasSprite sprite = texture_atlas.add(image);
+        if (!sprite.valid()) {
+            TraceLog(LOG_WARNING, "Failed to reload texture, keeping the old one: %s", path.c_str());
+            return;
+        }
+
+        // Added before the old sprite goes so its atlas page isn't freed and recreated
+        Residency& r = residency[handle.index];
+        texture_atlas.remove(textures.slots[handle.index].asset);
+        counters.resident--;
+        counters.resident_bytes -= (size_t)r.width * r.height * 4;
+        make_resident(handle.index, sprite);
+        TraceLog(LOG_INFO, "Reloaded texture: %s", path.c_str());
+    });
+    return true;
+}
+
+void AssetManager::update()
+{
+    if (shut_down)
+        return;
+    frame++;
+
+    if (placeholder_texture.id == 0) {
+        Image checker = GenImageChecked(16, 16, 8, 8, MAGENTA, BLACK);
+        placeholder_texture = LoadTextureFromImage(checker);
+        UnloadImage(checker);
+        SetTextureWrap(placeholder_texture, TEXTURE_WRAP_REPEAT);
+        for (uint32_t i = 0; i < textures.slots.size(); ++i) {
+            if (textures.slots[i].refs > 0 && !residency[i].resident)
+                textures.slots[i].asset = placeholder(residency[i].width, residency[i].height);
+        }
+    }
+
+    if (loader)
+        loader->pump();
+
+    // Everything drawn while missing last frame goes out as one batch
+    std::vector<std::string> paths;
+    std::vector<TextureHandle> handles;
+    for (uint32_t i = 0; i < textures.slots.size(); ++i) {
+        Residency& r = residency[i];
+        if (textures.slots[i].refs <= 0 || !r.requested || r.loading || r.resident)
+            continue;
+
+        // Already decoded in the pack, straight to the atlas
+        if (const PakEntry* entry = asset_pack.find(textures.slots[i].path)) {
+            Image image = asset_pack.image(*entry);
+            AtlasSprite sprite = entry->kind == PAK_TEXTURE ? texture_atlas.add(image) : AtlasSprite {};
+            if (sprite.valid()) {
+                make_resident(i, sprite);
+                continue;
+            }
+        }
+
+        r.loading = true;
+        paths.push_back(textures.slots[i].path);
+        handles.push_back({ i, textures.slots[i].generation });
+    }
+
+    if (!paths.empty()) {
+        if (!loader)
+            loader = std::make_unique<ImageLoader>();
+
+        loader->request_batch(paths, [this, handles, paths](std::vector<Image>& images) {
+            std::vector<AtlasSprite> sprites = texture_atlas.add_all(images);
+            for (size_t i = 0; i < handles.size(); ++i) {
+                TextureHandle h = handles[i];
+                bool alive = textures.get(h.index, h.generation) != nullptr;
+                if (alive)
+                    residency[h.index].loading = false;
+
+                if (!sprites[i].valid()) {
+                    if (alive) {
+                        residency[h.index].failed = true;
+                        TraceLog(LOG_WARNING, "Texture stays a placeholder: %s", paths[i].c_str());
+                    }
+                    continue;
+                }
+                // Released while loading
+                if (!alive || residency[h.index].resident) {
+                    texture_atlas.remove(sprites[i]);
+                    continue;
+                }
+                make_resident(h.index, sprites[i]);
+            }
+        });
+    }
+
+    // Least recently drawn first, never what was drawn last frame
+    while (counters.resident_bytes > texture_budget) {
+        uint32_t victim = UINT32_MAX;
+        for (uint32_t i = 0; i < textures.slots.size(); ++i) {
+            const Residency& r = residency[i];
+            if (textures.slots[i].refs <= 0 || !r.resident || r.last_used + 1 >= frame)
+                continue;
+            if (victim == UINT32_MAX || r.last_used < residency[victim].last_used)
+                victim = i;
+        }
+        if (victim == UINT32_MAX)
+            break; // the working set alone is over budget
+        evict(victim);
+    }
+}
+
+SoundHandle AssetManager::load_sound(const std::string& path)
+{
+    SoundHandle handle = find<SoundHandle>(sounds, path);
+    if (handle.valid()) {
+        acquire(handle);
+        return handle;
+    }
+
+    Sound sound = {};
+    const PakEntry* entry = asset_pack.find(path);
+    if (entry && entry->kind == PAK_SOUND) {
+        Wave wave = LoadWaveFromMemory(GetFileExtension(path.c_str()), asset_pack.data(*entry), (int)entry->size);
+        sound = LoadSoundFromWave(wave);
+        UnloadWave(wave);
+    } else {
+        sound = LoadSound(path.c_str());
+    }
+    if (sound.frameCount == 0) {
+        TraceLog(LOG_ERROR, "Failed to load sound: %s", path.c_str());
+        return {};
+    }
+
+    uint32_t index = sounds.allocate(path, sound);
+    return { index, sounds.slots[index].generation };
+}
+
+void AssetManager::acquire(SoundHandle handle)
+{
+    if (auto* slot = sounds.get(handle.index, handle.generation))
+        slot->refs++;
+}
+
+void AssetManager::release(SoundHandle& handle)
+{
+    if (!shut_down) {
+        const auto* slot = sounds.get(handle.index, handle.generation);
+        Sound sound = slot ? slot->asset : Sound {};
+        if (sounds.release(handle.index, handle.generation))
+            UnloadSound(sound);
+    }
+    handle = {};
+}
+
+void AssetManager::play(SoundHandle handle) const
+{
+    if (const auto* slot = sounds.get(handle.index, handle.generation))
+        PlaySound(slot->asset);
+}
+
+void AssetManager::unload_all()
+{
+    loader.reset();
+    for (uint32_t i = 0; i < textures.slots.size(); ++i) {
+        if (textures.slots[i].refs > 0 && residency[i].resident)
+            texture_atlas.remove(textures.slots[i].asset);
+    }
+    if (placeholder_texture.id != 0)
+        UnloadTexture(placeholder_texture);
+    placeholder_texture = {};
+    residency.clear();
+    counters = {};
+    for (auto& slot : sounds.slots) {
+        if (slot.refs > 0)
+            UnloadSound(slot.asset);
+    }
+
+    textures = {};
+    sounds = {};
+    shut_down = true;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "image_loader.h"
+#include "texture_atlas.h"
+#include <cstdint>
+#include <memory>
+#include <raylib.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Index into one of the AssetManager pools. The generation tells a handle to a
+// freed (and possibly reused) slot apart from a live one.
+template <typename Tag>
+struct AssetHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0; // 0 = no asset
+
+    bool valid() const { return generation != 0; }
+    bool operator==(const AssetHandle& o) const { return index == o.index && generation == o.generation; }
+    bool operator!=(const AssetHandle& o) const { return !(*this == o); }
+};
+
+using TextureHandle = AssetHandle<struct TextureTag>;
+using SoundHandle = AssetHandle<struct SoundTag>;
+
+// Owns every texture (as texture_atlas sprites) and sound. Assets are shared by
+// path, reference counted, and unloaded when the last reference is released.
+// Every load/add/acquire must be paired with a release.
+//
+// Textures are also paged in and out: a texture is decoded the first time it is
+// drawn, and when resident pixels exceed texture_budget the least recently drawn
+// ones go back to disk. Until (re)loaded a texture draws as a checkerboard of its size.
+class AssetManager {
+
+public:
+    static constexpr int PLACEHOLDER_PAGE = 64; // batch bucket of the placeholder, past any real atlas page
+
+    size_t texture_budget = 128u << 20; // bytes of resident texture pixels
+
+    struct Stats {
+        size_t resident_bytes = 0;
+        int resident = 0;
+        uint64_t hits = 0; // lookups of resident textures
+        uint64_t misses = 0; // lookups that had to queue a load
+        int loads = 0;
+        int evictions = 0;
+    };
+
+    // Registers path, it is decoded on first use. Later calls for the same path only add a reference.
+    TextureHandle load_texture(const std::string& path);
+    // Same, with pixels already decoded (e.g. by an ImageLoader), resident right away
+    TextureHandle add_texture(const std::string& path, Image& image);
+    // Doesn't add a reference, invalid handle when not loaded
+    TextureHandle find_texture(const std::string& path) const;
+
+    void acquire(TextureHandle handle);
+    // Clears handle, the texture is freed with its last reference
+    void release(TextureHandle& handle);
+
+    // Marks the texture as drawn this frame. Non-resident textures are queued for
+    // loading and return the placeholder, invalid or stale handles an empty sprite.
+    const AtlasSprite& sprite(TextureHandle handle) const;
+    const std::string& path(TextureHandle handle) const;
+    int refs(TextureHandle handle) const;
+    bool resident(TextureHandle handle) const;
+    // The file behind path changed: resident textures are re-decoded off-thread and swapped
+    // in under the same handle, others pick the new file up on their next load. False if unknown.
+    bool reload(const std::string& path);
+
+    // Once per frame on the GL thread: uploads finished loads, queues new ones, enforces the budget
+    void update();
+    const Stats& stats() const { return counters; }
+    // Changes whenever a texture finishes loading, so anything that captured a placeholder can redraw
+    uint32_t residency_epoch() const { return epoch; }
+
+    SoundHandle load_sound(const std::string& path);
+    void acquire(SoundHandle handle);
+    void release(SoundHandle& handle);
+    void play(SoundHandle handle) const;
+
+    int texture_count() const { return textures.live; }
+    int sound_count() const { return sounds.live; }
+
+    // Frees everything regardless of references, must run before the window closes.
+    // Releases after this are no-ops.
+    void unload_all();
+
+private:
+    template <typename T>
+    struct Slot {
+        std::string path;
+        T asset = {};
+        int refs = 0;
+        uint32_t generation = 1;
+    };
+
+    template <typename T>
+    struct Pool {
+        std::vector<Slot<T>> slots;
+        std::vector<uint32_t> free;
+        std::unordered_map<std::string, uint32_t> by_path;
+        int live = 0;
+
+        Slot<T>* get(uint32_t index, uint32_t generation)
+        {
+            if (generation == 0 || index >= slots.size() || slots[index].generation != generation || slots[index].refs <= 0)
+                return nullptr;
+            return &slots[index];
+        }
+        const Slot<T>* get(uint32_t index, uint32_t generation) const
+        {
+            return const_cast<Pool*>(this)->get(index, generation);
+        }
+        uint32_t allocate(const std::string& path, const T& asset);
+        // Returns true when the slot was freed
+        bool release(uint32_t index, uint32_t generation);
+    };
+
+    template <typename Handle, typename T>
+    static Handle find(const Pool<T>& pool, const std::string& path);
+
+    // Residency of the texture slot with the same index
+    struct Residency {
+        bool resident = false;
+        bool requested = false; // drawn while not resident
+        bool loading = false;
+        bool failed = false; // don't retry a file that doesn't decode
+        int width = 64; // known after the first load, sizes the placeholder
+        int height = 64;
+        uint64_t last_used = 0; // frame
+    };
+
+    TextureHandle allocate_texture(const std::string& path);
+    void make_resident(uint32_t index, const AtlasSprite& sprite);
+    void evict(uint32_t index);
+    AtlasSprite placeholder(int width, int height) const;
+
+    Pool<AtlasSprite> textures;
+    Pool<Sound> sounds;
+    // sprite() is called from const draw code, it only records use
+    mutable std::vector<Residency> residency;
+    mutable Stats counters;
+    uint64_t frame = 1;
+    uint32_t epoch = 0;
+    Texture2D placeholder_texture = {};
+    std::unique_ptr<ImageLoader> loader; // started with the first lazy load
+    bool shut_down = false;
+};
+
+inline AssetManager assets;
@@ -0,0 +1,249 @@
+#include "asset_pack.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+uint64_t pak_hash(const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string resource_name(const std::string& path)
+{
+    std::string p = path;
+    std::replace(p.begin(), p.end(), '\\', '/');
+
+    // Maps saved on another machine still point into its resources/ folder
+    size_t at = p.rfind("resources/");
+    if (at != std::string::npos && (at == 0 || p[at - 1] == '/'))
+        return p.substr(at + 10);
+
+    bool absolute = !p.empty() && (p[0] == '/' || (p.size() > 1 && p[1] == ':'));
+    return absolute ? std::string() : p;
+}
+
+std::string content_ref(uint64_t contentId)
+{
+    char ref[20];
+    std::snprintf(ref, sizeof(ref), "@%016" PRIx64, contentId);
+    return ref;
+}
+
+bool AssetPack::open(const std::string& path)
+{
+    close();
+    if (!file.open(path))
+        return false;
+
+    PakHeader header;
+    if (file.size() < sizeof(header)) {
+        close();
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    size_t tableEnd = sizeof(header) + (size_t)header.entry_count * sizeof(PakEntry);
+    if (header.magic != PAK_MAGIC || header.version != PAK_VERSION || tableEnd + header.names_size > file.size()
+        || header.names_size == 0 || file.data()[tableEnd + header.names_size - 1] != '\0') {
+        TraceLog(LOG_ERROR, "Invalid asset pack %s", path.c_str());
+        close();
+        return false;
+    }
+
+    entries = (const PakEntry*)(file.data() + sizeof(header));
+    entry_count = header.entry_count;
+    names = (const char*)(file.data() + tableEnd);
+
+    for (uint32_t i = 0; i < entry_count; ++i) {
+        const PakEntry& e = entries[i];
+        if (e.offset > file.size() || e.size > file.size() - e.offset || e.name_offset >= header.names_size
+            || (e.kind == PAK_TEXTURE && (e.width <= 0 || e.height <= 0 || e.size != (uint64_t)e.width * e.height * 4))) {
+            TraceLog(LOG_ERROR, "Corrupt entry %u in asset pack %s", i, path.c_str());
+            close();
+            return false;
+        }
+        if (e.kind == PAK_TEXTURE)
+            by_content.emplace(e.content_id, i);
+    }
+
+#ifndef _WIN32
+    // Read ahead in large sequential chunks instead of faulting pages in one by one
+    posix_madvise((void*)file.data(), file.size(), POSIX_MADV_SEQUENTIAL);
+    posix_madvise((void*)file.data(), file.size(), POSIX_MADV_WILLNEED);
+#endif
+
+    TraceLog(LOG_INFO, "Asset pack %s: %u assets, %.1f MB", path.c_str(), entry_count, file.size() / (1024.0 * 1024.0));
+    return true;
+}
+
+void AssetPack::close()
+{
+    file.close();
+    entries = nullptr;
+    entry_count = 0;
+    names = nullptr;
+    by_content.clear();
+}
+
+const PakEntry* AssetPack::find(const std::string& path) const
+{
+    if (!is_open())
+        return nullptr;
+
+    std::string name = resource_name(path);
+    if (name.empty())
+        return nullptr;
+
+    uint64_t hash = pak_hash(name.data(), name.size());
+    const PakEntry* end = entries + entry_count;
+    const PakEntry* it = std::lower_bound(entries, end, hash, [](const PakEntry& e, uint64_t h) { return e.name_hash < h; });
+    for (; it != end && it->name_hash == hash; ++it) {
+        if (name == this->name(*it))
+            return it;
+    }
+    return nullptr;
+}
+
+const PakEntry* AssetPack::find_content(uint64_t contentId) const
+{
+    auto it = by_content.find(contentId);
+    return it != by_content.end() ? &entries[it->second] : nullptr;
+}
+
+std::string AssetPack::resolve(const std::string& name) const
+{
+    if (name.size() != 17 || name[0] != '@')
+        return name;
+
+    const PakEntry* entry = find_content(std::strtoull(name.c_str() + 1, nullptr, 16));
+    return entry ? this->name(*entry) : name;
+}
+
+std::vector<const PakEntry*> AssetPack::list(ePakKind kind, const std::string& prefix) const
+{
+    std::vector<const PakEntry*> result;
+    for (uint32_t i = 0; i < entry_count; ++i) {
+        if (entries[i].kind == kind && std::strncmp(name(entries[i]), prefix.c_str(), prefix.size()) == 0)
+            result.push_back(&entries[i]);
+    }
+    // Table order is by hash, list by name
+    std::sort(result.begin(), result.end(), [this](const PakEntry* a, const PakEntry* b) { return std::strcmp(name(*a), name(*b)) < 0; });
+    return result;
+}
+
+Image AssetPack::image(const PakEntry& entry) const
+{
+    Image image = {};
+    image.data = (void*)data(entry);
+    image.width = entry.width;
+    image.height = entry.height;
+    image.mipmaps = 1;
+    image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    return image;
+}
+
+Image AssetPack::load_image(const std::string& path) const
+{
+    const PakEntry* entry = find(path);
+    if (!entry || entry->kind != PAK_TEXTURE)
+        return {};
+    return ImageCopy(image(*entry));
+}
+
+uint64_t PakBuilder::add(const std::string& name, ePakKind kind, std::vector<uint8_t> bytes, int width, int height)
+{
+    // Same pixels at another size are different content
+    uint64_t id = pak_hash(bytes.data(), bytes.size()) ^ (((uint64_t)width << 32 | (uint32_t)height) * 0x9e3779b97f4a7c15ull);
+    if (blobs.find(id) == blobs.end()) {
+        stored += bytes.size();
+        blobs.emplace(id, std::move(bytes));
+        blob_order.push_back(id);
+    }
+    items.push_back({ name, (uint32_t)kind, id, width, height });
+    return id;
+}
+
+bool PakBuilder::write(const std::string& path) const
+{
+    std::string names;
+    std::vector<PakEntry> table(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        PakEntry& e = table[i];
+        e.name_hash = pak_hash(items[i].name.data(), items[i].name.size());
+        e.content_id = items[i].content_id;
+        e.kind = items[i].kind;
+        e.name_offset = (uint32_t)names.size();
+        e.width = items[i].width;
+        e.height = items[i].height;
+        names += items[i].name;
+        names += '\0';
+    }
+
+    // Blob offsets, in the order they were added
+    std::unordered_map<uint64_t, uint64_t> offsets;
+    uint64_t at = sizeof(PakHeader) + table.size() * sizeof(PakEntry) + names.size();
+    for (uint64_t id : blob_order) {
+        at = (at + PAK_ALIGNMENT - 1) / PAK_ALIGNMENT * PAK_ALIGNMENT;
+        offsets[id] = at;
+        at += blobs.at(id).size();
+    }
+    for (PakEntry& e : table) {
+        e.offset = offsets[e.content_id];
+        e.size = blobs.at(e.content_id).size();
+    }
+
+    // Entries point at names by offset, so sorting the table afterwards is fine
+    std::sort(table.begin(), table.end(), [](const PakEntry& a, const PakEntry& b) { return a.name_hash < b.name_hash; });
+
+    PakHeader header = {};
+    header.magic = PAK_MAGIC;
+    header.version = PAK_VERSION;
+    header.entry_count = (uint32_t)table.size();
+    header.names_size = (uint32_t)names.size();
+
+    std::string tmpPath = path + ".tmp";
+    FILE* out = std::fopen(tmpPath.c_str(), "wb");
+    if (!out) {
+        TraceLog(LOG_ERROR, "Can't write %s", tmpPath.c_str());
+        return false;
+    }
+
+    static const uint8_t zeros[PAK_ALIGNMENT] = {};
+    uint64_t pos = 0;
+    auto put = [&](const void* data, size_t size) {
+        std::fwrite(data, 1, size, out);
+        pos += size;
+    };
+    put(&header, sizeof(header));
+    put(table.data(), table.size() * sizeof(PakEntry));
+    put(names.data(), names.size());
+    for (uint64_t id : blob_order) {
+        put(zeros, offsets[id] - pos);
+        const std::vector<uint8_t>& blob = blobs.at(id);
+        put(blob.data(), blob.size());
+    }
+
+    bool ok = std::ferror(out) == 0;
+    ok = std::fclose(out) == 0 && ok;
+    std::error_code ec;
+    if (ok)
+        std::filesystem::rename(tmpPath, path, ec);
+    if (!ok || ec) {
+        std::filesystem::remove(tmpPath, ec);
+        TraceLog(LOG_ERROR, "Failed to write asset pack %s", path.c_str());
+        return false;
+    }
+    return true;
+}
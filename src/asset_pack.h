@@ -0,0 +1,121 @@
+#pragma once
+
+#include "mapped_file.h"
+#include <cstdint>
+#include <raylib.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+resources.pak v1 (little-endian), written by the cook tool:
+
+    PakHeader
+    PakEntry[entry_count]               sorted by name_hash
+    [char...] names                     names_size bytes, each name NUL terminated
+    blobs                               64-byte aligned, shared by entries with the same content_id
+
+Names are paths relative to resources/ with '/' separators ("tilemaps/grass.png").
+content_id is a hash of the blob, so identical files are stored once.
+
+    PAK_TEXTURE     RGBA8 pixels, width * height * 4 bytes
+    PAK_MAP         map.bin (see map_format.h) whose texture names are "@<content_id as 16 hex digits>"
+    PAK_SOUND       the source file as is, decoded by raylib from memory
+*/
+
+constexpr uint32_t PAK_MAGIC = 0x4b475052; // "RPGK"
+constexpr uint16_t PAK_VERSION = 1;
+constexpr size_t PAK_ALIGNMENT = 64;
+
+enum ePakKind : uint32_t {
+    PAK_TEXTURE = 1,
+    PAK_MAP = 2,
+    PAK_SOUND = 3,
+    PAK_DATA = 4, // text data read by the game itself (prefabs)
+};
+
+struct PakHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t entry_count;
+    uint32_t names_size;
+};
+
+struct PakEntry {
+    uint64_t name_hash;
+    uint64_t content_id;
+    uint64_t offset; // absolute
+    uint64_t size;
+    uint32_t kind;
+    uint32_t name_offset; // into the names block
+    int32_t width; // textures only
+    int32_t height;
+};
+
+static_assert(sizeof(PakHeader) == 16, "pak header layout changed");
+static_assert(sizeof(PakEntry) == 48, "pak entry layout changed");
+
+uint64_t pak_hash(const void* data, size_t size);
+// "tilemaps/grass.png" for any path into a resources/ folder, the path itself when relative, empty otherwise
+std::string resource_name(const std::string& path);
+// Texture reference stored in cooked maps
+std::string content_ref(uint64_t contentId);
+
+// Read-only view of a mapped pack, used instead of resources/ when one is found next to the executable
+class AssetPack {
+
+public:
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return file.is_open(); }
+
+    // Accepts names and absolute paths into resources/, nullptr when not cooked
+    const PakEntry* find(const std::string& path) const;
+    // First texture with those pixels, for "@<id>" references of cooked maps
+    const PakEntry* find_content(uint64_t contentId) const;
+    // "@<id>" references resolve to the texture's name, anything else is returned as is
+    std::string resolve(const std::string& name) const;
+    std::vector<const PakEntry*> list(ePakKind kind, const std::string& prefix) const;
+
+    const char* name(const PakEntry& entry) const { return names + entry.name_offset; }
+    const uint8_t* data(const PakEntry& entry) const { return file.data() + entry.offset; }
+    // Views the mapped pixels, never unload or modify it
+    Image image(const PakEntry& entry) const;
+    // Owned copy of a cooked texture, empty when path isn't in the pack
+    Image load_image(const std::string& path) const;
+
+private:
+    MappedFile file;
+    const PakEntry* entries = nullptr;
+    uint32_t entry_count = 0;
+    const char* names = nullptr;
+    std::unordered_map<uint64_t, uint32_t> by_content; // texture content_id -> entry
+};
+
+inline AssetPack asset_pack;
+
+// Collects assets for the cook tool and writes them as one pack
+class PakBuilder {
+
+public:
+    // Returns the content id. Blobs already added under another name are stored once.
+    uint64_t add(const std::string& name, ePakKind kind, std::vector<uint8_t> bytes, int width = 0, int height = 0);
+    // Written to path.tmp then renamed
+    bool write(const std::string& path) const;
+
+    size_t stored_bytes() const { return stored; }
+
+private:
+    struct Item {
+        std::string name;
+        uint32_t kind;
+        uint64_t content_id;
+        int width, height;
+    };
+
+    std::vector<Item> items;
+    std::unordered_map<uint64_t, std::vector<uint8_t>> blobs;
+    std::vector<uint64_t> blob_order; // first-added order, so related assets stay close on disk
+    size_t stored = 0;
+};
@@ -0,0 +1,86 @@
+#include "chunk_cache.h"
+
+const Texture2D* ChunkCache::lookup(uint64_t key, uint32_t revision)
+{
+    auto it = entries.find(key);
+    if (it == entries.end() || !it->second.valid || it->second.revision != revision)
+        return nullptr;
+
+    it->second.last_used = frame;
+    hits_this_frame++;
+    for (TextureHandle texture : it->second.textures)
+        assets.sprite(texture);
+    return &it->second.target.texture;
+}
+
+RenderTexture2D* ChunkCache::begin_bake(uint64_t key)
+{
+    if (bakes_this_frame >= bakes_per_frame)
+        return nullptr;
+
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        if ((int)entries.size() >= max_chunks)
+            evict_lru();
+
+        Entry entry;
+        entry.target = LoadRenderTexture(CHUNK_PIXELS_W, CHUNK_PIXELS_H);
+        if (entry.target.id == 0)
+            return nullptr;
+        it = entries.emplace(key, entry).first;
+    }
+
+    bakes_this_frame++;
+    it->second.valid = false;
+    it->second.last_used = frame;
+    return &it->second.target;
+}
+
+void ChunkCache::end_bake(uint64_t key, uint32_t revision, const std::vector<TextureHandle>& textures)
+{
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return;
+
+    it->second.textures = textures;
+    it->second.revision = revision;
+    it->second.valid = true;
+}
+
+void ChunkCache::new_frame()
+{
+    stats.cached = (int)entries.size();
+    stats.bakes = bakes_this_frame;
+    stats.hits = hits_this_frame;
+
+    frame++;
+    bakes_this_frame = 0;
+    hits_this_frame = 0;
+}
+
+void ChunkCache::evict_lru()
+{
+    auto oldest = entries.end();
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (oldest == entries.end() || it->second.last_used < oldest->second.last_used)
+            oldest = it;
+    }
+
+    if (oldest != entries.end()) {
+        UnloadRenderTexture(oldest->second.target);
+        entries.erase(oldest);
+    }
+}
+
+void ChunkCache::invalidate_all()
+{
+    for (auto& [key, entry] : entries)
+        entry.valid = false;
+}
+
+void ChunkCache::clear()
+{
+    for (auto& [key, entry] : entries)
+        UnloadRenderTexture(entry.target);
+    entries.clear();
+}
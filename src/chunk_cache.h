@@ -0,0 +1,74 @@
+#pragma once
+
+#include "asset_manager.h"
+#include "tile.h"
+#include <cstdint>
+#include <raylib.h>
+#include <unordered_map>
+#include <vector>
+
+// Static-layer cache: each TileGrid chunk is rasterized once into its own
+// render texture and redrawn as a single quad until its revision changes.
+class ChunkCache {
+
+public:
+    static constexpr int CHUNK_PIXELS_W = CHUNK_SIZE * TILE_WIDTH;
+    static constexpr int CHUNK_PIXELS_H = CHUNK_SIZE * TILE_HEIGHT;
+
+    int max_chunks = 64; // resident render targets, least recently drawn are dropped first
+    int bakes_per_frame = 8; // dirty chunks past this budget are drawn tile by tile
+
+    struct Stats {
+        int cached = 0;
+        int bakes = 0; // chunks rebaked last frame
+        int hits = 0; // chunks drawn from cache last frame
+    };
+    Stats stats;
+
+    bool is_clean(uint64_t key, uint32_t revision) const
+    {
+        auto it = entries.find(key);
+        return it != entries.end() && it->second.valid && it->second.revision == revision;
+    }
+    // Texture of a chunk baked at exactly this revision, nullptr when dirty or missing.
+    // The tilesets it was baked from count as drawn, so the AssetManager keeps them resident.
+    const Texture2D* lookup(uint64_t key, uint32_t revision);
+    // Render target to (re)bake a chunk into, nullptr once the per-frame budget is spent
+    RenderTexture2D* begin_bake(uint64_t key);
+    void end_bake(uint64_t key, uint32_t revision, const std::vector<TextureHandle>& textures);
+
+    void new_frame();
+    // Drops entries whose chunk no longer exists
+    template <typename Pred>
+    void drop_if(Pred&& pred)
+    {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (pred(it->first)) {
+                UnloadRenderTexture(it->second.target);
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void invalidate_all();
+    // Must run before the window closes
+    void clear();
+
+private:
+    struct Entry {
+        RenderTexture2D target;
+        uint32_t revision = 0;
+        bool valid = false;
+        std::vector<TextureHandle> textures; // tilesets the bake drew from
+        uint64_t last_used = 0;
+    };
+
+    void evict_lru();
+
+    std::unordered_map<uint64_t, Entry> entries;
+    uint64_t frame = 0;
+    int bakes_this_frame = 0;
+    int hits_this_frame = 0;
+};
@@ -0,0 +1,299 @@
+#include "collision_grid.h"
+#include <cmath>
+
+// Penetration below this is treated as touching, sweeps stop boxes exactly on a cell edge
+static constexpr float TOUCH_EPSILON = 1.0f / 1024.0f;
+
+// Tiles [first, last] covered by the span [lo, hi), in pixels
+static int first_cell(float lo, int size) { return (int)std::floor(lo / size); }
+static int last_cell(float hi, int size) { return (int)std::ceil(hi / size) - 1; }
+
+static int floor_div(int v, int d) { return v >= 0 ? v / d : -((-v + d - 1) / d); }
+
+static Rectangle to_pixels(const TileRect& r)
+{
+    return { (float)(r.x0 * TILE_WIDTH), (float)(r.y0 * TILE_HEIGHT), (float)((r.x1 - r.x0) * TILE_WIDTH), (float)((r.y1 - r.y0) * TILE_HEIGHT) };
+}
+
+void merge_solid_cells(const TileChunk& chunk, int cx, int cy, int width, int height, std::vector<TileRect>& out)
+{
+    // Cells past the map edge stay out of the rectangles
+    int baseX = cx * CHUNK_SIZE, baseY = cy * CHUNK_SIZE;
+    int sizeX = std::min(CHUNK_SIZE, width - baseX);
+    int sizeY = std::min(CHUNK_SIZE, height - baseY);
+    if (sizeX <= 0 || sizeY <= 0)
+        return;
+
+    bool open[CHUNK_SIZE * CHUNK_SIZE] = {}; // solid and not yet in a rectangle, row-major
+    for (int ly = 0; ly < sizeY; ++ly) {
+        for (int lx = 0; lx < sizeX; ++lx)
+            open[ly * CHUNK_SIZE + lx] = !chunk.tiles[TileChunk::index(lx, ly)].empty();
+    }
+
+    // Widest run first, then grow it down while the rows below are solid across the whole run
+    for (int ly = 0; ly < sizeY; ++ly) {
+        for (int lx = 0; lx < sizeX; ++lx) {
+            if (!open[ly * CHUNK_SIZE + lx])
+                continue;
+
+            int x1 = lx + 1;
+            while (x1 < sizeX && open[ly * CHUNK_SIZE + x1])
+                ++x1;
+
+            int y1 = ly + 1;
+            for (; y1 < sizeY; ++y1) {
+                bool full = true;
+                for (int x = lx; x < x1 && full; ++x)
+                    full = open[y1 * CHUNK_SIZE + x];
+                if (!full)
+                    break;
+            }
+
+            for (int y = ly; y < y1; ++y) {
+                for (int x = lx; x < x1; ++x)
+                    open[y * CHUNK_SIZE + x] = false;
+            }
+            out.push_back({ baseX + lx, baseY + ly, baseX + x1, baseY + y1 });
+        }
+    }
+}
+
+void CollisionGrid::reset(int width, int height)
+{
+    w = width;
+    h = height;
+    stride = (w + 63) / 64;
+    bits.assign((size_t)stride * h, 0);
+    shapes.clear();
+    compiled = true;
+}
+
+void CollisionGrid::clear_chunk(int cx, int cy)
+{
+    for (int y = std::max(0, cy * CHUNK_SIZE); y < std::min(h, (cy + 1) * CHUNK_SIZE); ++y) {
+        for (int x = std::max(0, cx * CHUNK_SIZE); x < std::min(w, (cx + 1) * CHUNK_SIZE); ++x)
+            bits[(size_t)y * stride + (x >> 6)] &= ~(1ull << (x & 63));
+    }
+}
+
+void CollisionGrid::fill_bits(const TileRect& r)
+{
+    for (int y = std::max(0, r.y0); y < std::min(h, r.y1); ++y) {
+        for (int x = std::max(0, r.x0); x < std::min(w, r.x1); ++x)
+            bits[(size_t)y * stride + (x >> 6)] |= 1ull << (x & 63);
+    }
+}
+
+void CollisionGrid::update(const TileGrid& layer)
+{
+    if (!compiled || layer.width() != w || layer.height() != h)
+        reset(layer.width(), layer.height());
+    else if (layer.version() == compiled_version)
+        return;
+
+    // Chunks erased since the last update
+    for (auto it = shapes.begin(); it != shapes.end();) {
+        int cx = TileGrid::key_cx(it->first), cy = TileGrid::key_cy(it->first);
+        if (layer.find_chunk(cx, cy)) {
+            ++it;
+            continue;
+        }
+        clear_chunk(cx, cy);
+        it = shapes.erase(it);
+    }
+
+    layer.for_each_chunk([&](int cx, int cy, const TileChunk& chunk) {
+        auto [it, added] = shapes.try_emplace(TileGrid::chunk_key(cx, cy));
+        ChunkShapes& entry = it->second;
+        if (!added && entry.revision == chunk.revision)
+            return;
+
+        clear_chunk(cx, cy);
+        entry.revision = chunk.revision;
+        entry.rects.clear();
+        merge_solid_cells(chunk, cx, cy, w, h, entry.rects);
+        for (const TileRect& r : entry.rects)
+            fill_bits(r);
+    });
+
+    compiled_version = layer.version();
+}
+
+void CollisionGrid::adopt(const TileGrid& layer, const std::vector<TileRect>& rects)
+{
+    reset(layer.width(), layer.height());
+    for (const TileRect& r : rects) {
+        if (r.empty())
+            continue;
+        int cx = floor_div(r.x0, CHUNK_SIZE), cy = floor_div(r.y0, CHUNK_SIZE);
+        const TileChunk* chunk = layer.find_chunk(cx, cy);
+        if (!chunk)
+            continue;
+
+        ChunkShapes& entry = shapes[TileGrid::chunk_key(cx, cy)];
+        entry.revision = chunk->revision;
+        entry.rects.push_back(r);
+        fill_bits(r);
+    }
+    // Chunks missing from the saved set, or edited since, are merged by update()
+    compiled_version = 0;
+}
+
+std::vector<TileRect> CollisionGrid::rects() const
+{
+    std::vector<TileRect> all;
+    all.reserve(rect_count());
+    for (const auto& [key, entry] : shapes)
+        all.insert(all.end(), entry.rects.begin(), entry.rects.end());
+    return all;
+}
+
+size_t CollisionGrid::rect_count() const
+{
+    size_t n = 0;
+    for (const auto& [key, entry] : shapes)
+        n += entry.rects.size();
+    return n;
+}
+
+bool CollisionGrid::overlaps(const Rectangle& box) const
+{
+    Rectangle inner = { box.x + TOUCH_EPSILON, box.y + TOUCH_EPSILON, box.width - 2 * TOUCH_EPSILON, box.height - 2 * TOUCH_EPSILON };
+    int cx0 = floor_div(first_cell(inner.x, TILE_WIDTH), CHUNK_SIZE), cx1 = floor_div(last_cell(inner.x + inner.width, TILE_WIDTH), CHUNK_SIZE);
+    int cy0 = floor_div(first_cell(inner.y, TILE_HEIGHT), CHUNK_SIZE), cy1 = floor_div(last_cell(inner.y + inner.height, TILE_HEIGHT), CHUNK_SIZE);
+
+    bool hit = false;
+    for (int cy = cy0; cy <= cy1 && !hit; ++cy) {
+        for (int cx = cx0; cx <= cx1 && !hit; ++cx) {
+            for_each_rect(cx, cy, [&](const TileRect& r) {
+                hit = hit || CheckCollisionRecs(inner, to_pixels(r));
+            });
+        }
+    }
+    return hit;
+}
+
+void CollisionGrid::query(const Rectangle& box, std::vector<Rectangle>& out) const
+{
+    int cx0 = floor_div(first_cell(box.x, TILE_WIDTH), CHUNK_SIZE), cx1 = floor_div(last_cell(box.x + box.width, TILE_WIDTH), CHUNK_SIZE);
+    int cy0 = floor_div(first_cell(box.y, TILE_HEIGHT), CHUNK_SIZE), cy1 = floor_div(last_cell(box.y + box.height, TILE_HEIGHT), CHUNK_SIZE);
+    for (int cy = cy0; cy <= cy1; ++cy) {
+        for (int cx = cx0; cx <= cx1; ++cx)
+            for_each_rect(cx, cy, [&](const TileRect& r) { out.push_back(to_pixels(r)); });
+    }
+}
+
+bool CollisionGrid::raycast(Vector2 from, Vector2 to, float& t) const
+{
+    const float chunkW = (float)(CHUNK_SIZE * TILE_WIDTH), chunkH = (float)(CHUNK_SIZE * TILE_HEIGHT);
+    float dx = to.x - from.x, dy = to.y - from.y;
+
+    // Walks the chunks the segment crosses in order. Rectangles never leave their chunk,
+    // so the first chunk with a hit holds the nearest one.
+    int cx = (int)std::floor(from.x / chunkW), cy = (int)std::floor(from.y / chunkH);
+    int endX = (int)std::floor(to.x / chunkW), endY = (int)std::floor(to.y / chunkH);
+    int stepX = dx > 0 ? 1 : -1, stepY = dy > 0 ? 1 : -1;
+    float tDeltaX = dx != 0 ? std::fabs(chunkW / dx) : INFINITY;
+    float tDeltaY = dy != 0 ? std::fabs(chunkH / dy) : INFINITY;
+    float tMaxX = dx != 0 ? ((cx + (dx > 0)) * chunkW - from.x) / dx : INFINITY;
+    float tMaxY = dy != 0 ? ((cy + (dy > 0)) * chunkH - from.y) / dy : INFINITY;
+
+    for (;;) {
+        float nearest = INFINITY;
+        for_each_rect(cx, cy, [&](const TileRect& r) {
+            // Slab test against the rectangle
+            Rectangle p = to_pixels(r);
+            float tx0 = dx != 0 ? (p.x - from.x) / dx : -INFINITY, tx1 = dx != 0 ? (p.x + p.width - from.x) / dx : INFINITY;
+            float ty0 = dy != 0 ? (p.y - from.y) / dy : -INFINITY, ty1 = dy != 0 ? (p.y + p.height - from.y) / dy : INFINITY;
+            if (dx == 0 && (from.x < p.x || from.x >= p.x + p.width))
+                return;
+            if (dy == 0 && (from.y < p.y || from.y >= p.y + p.height))
+                return;
+            float enter = std::max(std::min(tx0, tx1), std::min(ty0, ty1));
+            float leave = std::min(std::max(tx0, tx1), std::max(ty0, ty1));
+            if (enter <= leave && leave >= 0 && enter <= 1)
+                nearest = std::min(nearest, std::max(enter, 0.0f));
+        });
+        if (nearest <= 1) {
+            t = nearest;
+            return true;
+        }
+
+        if (cx == endX && cy == endY)
+            return false;
+        if (tMaxX < tMaxY) {
+            if (tMaxX > 1)
+                return false;
+            cx += stepX;
+            tMaxX += tDeltaX;
+        } else {
+            if (tMaxY > 1)
+                return false;
+            cy += stepY;
+            tMaxY += tDeltaY;
+        }
+    }
+}
+
+bool CollisionGrid::column_blocked(int x, int y0, int y1) const
+{
+    for (int y = y0; y <= y1; ++y) {
+        if (solid(x, y))
+            return true;
+    }
+    return false;
+}
+
+bool CollisionGrid::row_blocked(int y, int x0, int x1) const
+{
+    for (int x = x0; x <= x1; ++x) {
+        if (solid(x, y))
+            return true;
+    }
+    return false;
+}
+
+Vector2 CollisionGrid::sweep(const Rectangle& box, Vector2 delta) const
+{
+    // Only cells the leading edge enters are tested, so a box already inside a wall can still back out
+    Rectangle b = box;
+    if (delta.x != 0.0f) {
+        int y0 = first_cell(b.y, TILE_HEIGHT), y1 = last_cell(b.y + b.height, TILE_HEIGHT);
+        if (delta.x > 0.0f) {
+            for (int x = last_cell(b.x + b.width, TILE_WIDTH) + 1; x <= last_cell(b.x + b.width + delta.x, TILE_WIDTH); ++x) {
+                if (column_blocked(x, y0, y1)) {
+                    delta.x = x * TILE_WIDTH - (b.x + b.width);
+                    break;
+                }
+            }
+        } else {
+            for (int x = first_cell(b.x, TILE_WIDTH) - 1; x >= first_cell(b.x + delta.x, TILE_WIDTH); --x) {
+                if (column_blocked(x, y0, y1)) {
+                    delta.x = (x + 1) * TILE_WIDTH - b.x;
+                    break;
+                }
+            }
+        }
+        b.x += delta.x;
+    }
+
+    if (delta.y != 0.0f) {
+        int x0 = first_cell(b.x, TILE_WIDTH), x1 = last_cell(b.x + b.width, TILE_WIDTH);
+        if (delta.y > 0.0f) {
+            for (int y = last_cell(b.y + b.height, TILE_HEIGHT) + 1; y <= last_cell(b.y + b.height + delta.y, TILE_HEIGHT); ++y) {
+                if (row_blocked(y, x0, x1)) {
+                    delta.y = y * TILE_HEIGHT - (b.y + b.height);
+                    break;
+                }
+            }
+        } else {
+            for (int y = first_cell(b.y, TILE_HEIGHT) - 1; y >= first_cell(b.y + delta.y, TILE_HEIGHT); --y) {
+                if (row_blocked(y, x0, x1)) {
+                    delta.y = (y + 1) * TILE_HEIGHT - b.y;
+                    break;
+                }
+            }
+        }
+    }
+    return delta;
+}
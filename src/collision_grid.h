@@ -0,0 +1,73 @@
+#pragma once
+
+#include "tile_grid.h"
+#include <cstdint>
+#include <raylib.h>
+#include <unordered_map>
+#include <vector>
+
+// Greedy meshing of one chunk's painted cells into as few rectangles as it finds, in tile
+// coordinates clipped to width x height. Rectangles never leave their chunk.
+void merge_solid_cells(const TileChunk& chunk, int cx, int cy, int width, int height, std::vector<TileRect>& out);
+
+// Static collision compiled from the collision layer: one bit per tile for sweeps, and each
+// chunk's solid cells merged into a few rectangles for overlap tests and raycasts.
+// Cells outside the map are solid to sweeps. Only chunks whose revision changed are rebuilt.
+class CollisionGrid {
+
+public:
+    // Rebuilds the chunks of the collision layer that changed since the last call
+    void update(const TileGrid& layer);
+    // Installs rectangles saved with the map for layer's current chunks, so they aren't merged again
+    void adopt(const TileGrid& layer, const std::vector<TileRect>& rects);
+
+    bool solid(int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= w || y >= h)
+            return true;
+        return (bits[(size_t)y * stride + (x >> 6)] >> (x & 63)) & 1;
+    }
+    // True when box (world pixels) overlaps merged geometry. Boxes resting against a wall don't count.
+    bool overlaps(const Rectangle& box) const;
+    // Merged rectangles in the chunks box covers, in world pixels
+    void query(const Rectangle& box, std::vector<Rectangle>& out) const;
+    // First hit along from -> to, t is the fraction of the segment travelled
+    bool raycast(Vector2 from, Vector2 to, float& t) const;
+    // How far box can move by delta before hitting a solid cell, x then y so it slides along walls.
+    // Every cell between the start and the end is checked, so a long step can't skip a wall.
+    Vector2 sweep(const Rectangle& box, Vector2 delta) const;
+
+    // Every merged rectangle, in tile coordinates, for saving with the map
+    std::vector<TileRect> rects() const;
+    size_t rect_count() const;
+
+private:
+    struct ChunkShapes {
+        uint32_t revision = 0;
+        std::vector<TileRect> rects;
+    };
+
+    bool column_blocked(int x, int y0, int y1) const;
+    bool row_blocked(int y, int x0, int x1) const;
+    void reset(int width, int height);
+    void clear_chunk(int cx, int cy);
+    void fill_bits(const TileRect& r);
+    // fn(const TileRect&) for the rectangles of chunk (cx, cy)
+    template <typename Fn>
+    void for_each_rect(int cx, int cy, Fn&& fn) const
+    {
+        auto it = shapes.find(TileGrid::chunk_key(cx, cy));
+        if (it != shapes.end()) {
+            for (const TileRect& r : it->second.rects)
+                fn(r);
+        }
+    }
+
+    std::vector<uint64_t> bits; // rows of stride words
+    std::unordered_map<uint64_t, ChunkShapes> shapes; // by TileGrid::chunk_key
+    int w = 0;
+    int h = 0;
+    int stride = 0;
+    uint64_t compiled_version = 0;
+    bool compiled = false;
+};
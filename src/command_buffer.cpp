@@ -0,0 +1,12 @@
+#include "command_buffer.h"
+
+void CommandBuffer::apply()
+{
+    for (Command* command = first; command; command = command->next)
+        command->run(world, command->handle, command->payload);
+
+    first = nullptr;
+    last = nullptr;
+    count = 0;
+    arena.reset();
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "frame_arena.h"
+#include "world.h"
+#include <tuple>
+#include <type_traits>
+
+// Structural World changes recorded during the frame and applied together at one sync point,
+// so systems can spawn and destroy entities from inside World::each(). Commands and their
+// components are stored in a FrameArena: once it has warmed up, recording allocates nothing.
+// Commands run in the order they were recorded.
+class CommandBuffer {
+
+public:
+    explicit CommandBuffer(World& world)
+        : world(world)
+    {
+    }
+
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+    // The handle is valid right away, the entity exists after apply()
+    template <typename... C>
+    EntityHandle spawn(const C&... components)
+    {
+        EntityHandle handle = world.reserve();
+        using Payload = std::tuple<C...>;
+        push(handle, arena.make<Payload>(components...), [](World& w, EntityHandle h, const void* payload) {
+            std::apply([&](const C&... c) { w.create_reserved(h, c...); }, *(const Payload*)payload);
+        });
+        return handle;
+    }
+
+    // Same, for a component set chosen at run time (see World::create_from())
+    EntityHandle spawn_from(uint32_t signature, const ComponentValues& values)
+    {
+        struct Payload {
+            uint32_t signature;
+            ComponentValues values;
+        };
+        EntityHandle handle = world.reserve();
+        push(handle, arena.make<Payload>(Payload { signature, values }), [](World& w, EntityHandle h, const void* payload) {
+            const Payload* p = (const Payload*)payload;
+            w.create_reserved_from(h, p->signature, p->values);
+        });
+        return handle;
+    }
+
+    void destroy(EntityHandle handle)
+    {
+        push(handle, nullptr, [](World& w, EntityHandle h, const void*) { w.destroy(h); });
+    }
+
+    template <typename C>
+    void set(EntityHandle handle, const C& component)
+    {
+        static_assert(std::is_trivially_copyable<C>::value, "Components are copied as plain data");
+        push(handle, arena.make<C>(component), [](World& w, EntityHandle h, const void* payload) { w.set(h, *(const C*)payload); });
+    }
+
+    template <typename C>
+    void remove(EntityHandle handle)
+    {
+        push(handle, nullptr, [](World& w, EntityHandle h, const void*) { w.remove<C>(h); });
+    }
+
+    // Runs every command, then starts an empty buffer. Not to be called inside World::each().
+    void apply();
+
+    size_t size() const { return count; }
+    const FrameArena& memory() const { return arena; }
+
+private:
+    using Run = void (*)(World&, EntityHandle, const void*);
+
+    struct Command {
+        Run run;
+        EntityHandle handle;
+        const void* payload;
+        Command* next;
+    };
+
+    void push(EntityHandle handle, const void* payload, Run run)
+    {
+        Command* command = arena.make<Command>(Command { run, handle, payload, nullptr });
+        if (last)
+            last->next = command;
+        else
+            first = command;
+        last = command;
+        count++;
+    }
+
+    World& world;
+    FrameArena arena;
+    Command* first = nullptr;
+    Command* last = nullptr;
+    size_t count = 0;
+};
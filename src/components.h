@@ -0,0 +1,139 @@
+#pragma once
+
+#include "asset_manager.h"
+#include "sprite_animation.h"
+#include "tile.h"
+#include <cstdint>
+#include <raylib.h>
+#include <tuple>
+#include <vector>
+
+// Plain data components for World entities. They are moved between archetypes with
+// plain copies, so none of them owns anything; World takes the one reference they
+// hold (Animation::sheet) when the component is added and drops it when it's removed.
+
+// Transform, named so it doesn't clash with raylib's
+struct Position {
+    float x = 0.0f; // top-left corner, in pixels
+    float y = 0.0f;
+    float scale = 1.0f; // size in tiles
+};
+
+// Kept in step with Position by sync_hitboxes()
+struct Hitbox {
+    Rectangle rect = {};
+};
+
+// Same sheet layout and playback as SpriteAnimation
+struct Animation {
+    TextureHandle sheet;
+    int rows = 1;
+    int cols = 1;
+    int size = 0;
+    float frame_time = 0.2f;
+    int frame_span = 1;
+    bool row_based = true;
+
+    eDirection direction = eDirection::Down;
+    int frame = 0;
+    float timer = 0.0f;
+};
+
+struct Health {
+    int health = 100;
+    int damage = 0;
+    int points = 0;
+};
+
+struct Zone {
+    eZone zone = eZone::ALL;
+};
+
+struct Collider {
+    uint32_t layer = 1; // eCollisionLayer
+    uint32_t mask = 0xffffffffu; // layers this entity collides with
+    bool blocking = false; // stops the player
+};
+
+// Destroyed by expire() once seconds runs out
+struct Lifetime {
+    float seconds = 0.0f;
+};
+
+// Static frame: src is in sheet pixels
+struct Sprite {
+    TextureHandle sheet;
+    Rectangle src = {};
+};
+
+// Touching it and pressing E moves the player between zones a and b
+struct Portal {
+    eZone a = eZone::WORLD;
+    eZone b = eZone::DUNGEON;
+};
+
+// Index of the prefab the entity was made from, see PrefabLibrary
+struct PrefabRef {
+    uint32_t prefab = 0;
+};
+
+// Component bits, in the order of ComponentColumns
+enum eComponent : uint32_t {
+    COMPONENT_POSITION = 1 << 0,
+    COMPONENT_HITBOX = 1 << 1,
+    COMPONENT_ANIMATION = 1 << 2,
+    COMPONENT_HEALTH = 1 << 3,
+    COMPONENT_ZONE = 1 << 4,
+    COMPONENT_COLLIDER = 1 << 5,
+    COMPONENT_LIFETIME = 1 << 6,
+    COMPONENT_SPRITE = 1 << 7,
+    COMPONENT_PORTAL = 1 << 8,
+    COMPONENT_PREFAB = 1 << 9,
+};
+
+// One array per component type, the layout of every archetype
+using ComponentColumns = std::tuple<
+    std::vector<Position>,
+    std::vector<Hitbox>,
+    std::vector<Animation>,
+    std::vector<Health>,
+    std::vector<Zone>,
+    std::vector<Collider>,
+    std::vector<Lifetime>,
+    std::vector<Sprite>,
+    std::vector<Portal>,
+    std::vector<PrefabRef>>;
+
+constexpr size_t COMPONENT_COUNT = std::tuple_size<ComponentColumns>::value;
+
+// One value of every component type, for component sets only known at run time (prefabs)
+template <typename Columns>
+struct ComponentValuesOf;
+template <typename... C>
+struct ComponentValuesOf<std::tuple<std::vector<C>...>> {
+    using type = std::tuple<C...>;
+};
+using ComponentValues = ComponentValuesOf<ComponentColumns>::type;
+
+template <typename C, size_t I = 0>
+constexpr uint32_t component_bit()
+{
+    if constexpr (std::is_same<std::tuple_element_t<I, ComponentColumns>, std::vector<C>>::value)
+        return 1u << I;
+    else
+        return component_bit<C, I + 1>();
+}
+
+static_assert(component_bit<Position>() == COMPONENT_POSITION && component_bit<PrefabRef>() == COMPONENT_PREFAB,
+    "eComponent and ComponentColumns are out of order");
+
+// Called as a component is attached to / detached from an entity, not when it moves between archetypes
+template <typename C>
+void component_added(C&) { }
+template <typename C>
+void component_removed(C&) { }
+
+inline void component_added(Animation& anim) { assets.acquire(anim.sheet); }
+inline void component_removed(Animation& anim) { assets.release(anim.sheet); }
+inline void component_added(Sprite& sprite) { assets.acquire(sprite.sheet); }
+inline void component_removed(Sprite& sprite) { assets.release(sprite.sheet); }
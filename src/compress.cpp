@@ -0,0 +1,153 @@
+#include "compress.h"
+#include <cstring>
+
+static constexpr int MIN_MATCH = 4;
+static constexpr int HASH_BITS = 14;
+static constexpr size_t MAX_OFFSET = 65535;
+
+static uint32_t read32(const uint8_t* p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static void put_length(std::vector<uint8_t>& out, size_t len)
+{
+    // Lengths past the 4-bit token nibble continue in 255-valued bytes
+    while (len >= 255) {
+        out.push_back(255);
+        len -= 255;
+    }
+    out.push_back((uint8_t)len);
+}
+
+static void emit_sequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t litLen, size_t offset, size_t matchLen)
+{
+    size_t matchCode = matchLen ? matchLen - MIN_MATCH : 0;
+    uint8_t token = (uint8_t)(((litLen < 15 ? litLen : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    out.push_back(token);
+    if (litLen >= 15)
+        put_length(out, litLen - 15);
+
+    out.insert(out.end(), literals, literals + litLen);
+
+    if (matchLen == 0)
+        return; // last sequence carries literals only
+
+    out.push_back((uint8_t)(offset & 0xff));
+    out.push_back((uint8_t)(offset >> 8));
+    if (matchCode >= 15)
+        put_length(out, matchCode - 15);
+}
+
+std::vector<uint8_t> lz_compress(const uint8_t* src, size_t size)
+{
+    std::vector<uint8_t> out;
+    out.reserve(size / 2 + 16);
+
+    std::vector<int32_t> table(1 << HASH_BITS, -1);
+    size_t anchor = 0;
+    size_t i = 0;
+
+    while (i + MIN_MATCH <= size) {
+        uint32_t seq = read32(src + i);
+        uint32_t h = (seq * 2654435761u) >> (32 - HASH_BITS);
+        int32_t candidate = table[h];
+        table[h] = (int32_t)i;
+
+        if (candidate >= 0 && i - candidate <= MAX_OFFSET && read32(src + candidate) == seq) {
+            size_t len = MIN_MATCH;
+            while (i + len < size && src[candidate + len] == src[i + len])
+                len++;
+
+            emit_sequence(out, src + anchor, i - anchor, i - candidate, len);
+            i += len;
+            anchor = i;
+        } else {
+            i++;
+        }
+    }
+
+    emit_sequence(out, src + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+static bool get_length(const uint8_t*& ip, const uint8_t* end, size_t& len)
+{
+    uint8_t b;
+    do {
+        if (ip >= end)
+            return false;
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+bool lz_decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dst_size)
+{
+    const uint8_t* ip = src;
+    const uint8_t* end = src + size;
+    size_t op = 0;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+
+        size_t litLen = token >> 4;
+        if (litLen == 15 && !get_length(ip, end, litLen))
+            return false;
+        if ((size_t)(end - ip) < litLen || dst_size - op < litLen)
+            return false;
+        std::memcpy(dst + op, ip, litLen);
+        ip += litLen;
+        op += litLen;
+
+        if (ip == end)
+            break; // last sequence
+
+        if (end - ip < 2)
+            return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        size_t matchLen = token & 15;
+        if (matchLen == 15 && !get_length(ip, end, matchLen))
+            return false;
+        matchLen += MIN_MATCH;
+
+        if (offset == 0 || offset > op || dst_size - op < matchLen)
+            return false;
+
+        // Byte by byte: matches may overlap the bytes they produce (runs)
+        const uint8_t* from = dst + op - offset;
+        for (size_t k = 0; k < matchLen; ++k)
+            dst[op + k] = from[k];
+        op += matchLen;
+    }
+
+    return op == dst_size;
+}
+
+void put_varint(std::vector<uint8_t>& out, uint32_t value)
+{
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+bool get_varint(const uint8_t*& p, const uint8_t* end, uint32_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p >= end)
+            return false;
+        uint8_t b = *p++;
+        value |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Byte-oriented LZ77 compressor using an LZ4-style block layout:
+// sequences of [token][literal length ext][literals][u16 offset][match length ext].
+// Small and dependency free, meant for already run-length encoded map data.
+std::vector<uint8_t> lz_compress(const uint8_t* src, size_t size);
+// dst_size must be the exact uncompressed size, returns false on malformed input
+bool lz_decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dst_size);
+
+// LEB128-style unsigned varint
+void put_varint(std::vector<uint8_t>& out, uint32_t value);
+bool get_varint(const uint8_t*& p, const uint8_t* end, uint32_t& value);
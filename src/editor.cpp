@@ -2,15 +2,16 @@
 #include "extras/IconsFontAwesome6.h"
 #include "imgui.h"
 #include "map.h"
+#include "prefab.h"
 #include <ImGuiFileDialog.h>
 #include <experimental/filesystem>
 
-void Editor::load_tilemap(Texture2D& tex, int tileW, int tileH)
+void Editor::load_tilemap(const AtlasSprite& tex, int tileW, int tileH)
 {
     tile_width = tileW;
     tile_height = tileH;
-    tiles_x = tex.width / tile_width;
-    tiles_y = tex.height / tile_height;
+    tiles_x = tex.width() / tile_width;
+    tiles_y = tex.height() / tile_height;
 }
 
 void Editor::draw_tilemap_panel()
@@ -29,7 +30,7 @@ void Editor::draw_tilemap_panel()
                 selectedTextureIndex = i;
 
                 // Update tile layout info when switching texture
-                load_tilemap(map.textures[i], TILE_WIDTH, TILE_HEIGHT);
+                load_tilemap(map.texture(i), TILE_WIDTH, TILE_HEIGHT);
             }
             if (isSelected)
                 ImGui::SetItemDefaultFocus();
@@ -56,6 +57,45 @@ void Editor::draw_tilemap_panel()
     }
     ImGui::PopStyleColor();
 
+    // ---- Layers: pick the one to paint, toggle visibility and lock ----
+    ImGui::Text(ICON_FA_LAYER_GROUP " Layers");
+    for (int i = 0; i < LAYER_COUNT; ++i) {
+        ImGui::PushID(i);
+        ImGui::Checkbox(ICON_FA_EYE "##visible", &layer_visible[i]);
+        ImGui::SameLine();
+        ImGui::Checkbox(ICON_FA_LOCK "##locked", &layer_locked[i]);
+        ImGui::SameLine();
+        if (ImGui::RadioButton(LAYER_NAMES[i], active_layer == i))
+            active_layer = i;
+        ImGui::PopID();
+    }
+
+    // ---- Entities: prefabs placed on the map, saved with it ----
+    ImGui::Checkbox(ICON_FA_CUBE " Place entities", &entity_mode);
+    if (entity_mode && prefabs && prefabs->size() > 0) {
+        selected_prefab = std::clamp(selected_prefab, 0, (int)prefabs->size() - 1);
+        if (ImGui::BeginCombo("Prefab", (*prefabs)[selected_prefab].name.c_str())) {
+            for (int i = 0; i < (int)prefabs->size(); ++i) {
+                if (ImGui::Selectable((*prefabs)[i].name.c_str(), selected_prefab == i))
+                    selected_prefab = i;
+            }
+            ImGui::EndCombo();
+        }
+        const char* zoneNames[] = { "ALL", "WORLD", "DUNGEON" };
+        ImGui::Combo("Zone", &placement_zone, zoneNames, IM_ARRAYSIZE(zoneNames));
+    }
+    ImGui::Text("Entities: %d placed", (int)map.entities.placed.size());
+
+    // ---- Map size (chunks outside the new bounds are dropped) ----
+    ImGui::SetNextItemWidth(120.0f);
+    ImGui::InputInt2("##MapSize", map_size);
+    map_size[0] = std::clamp(map_size[0], 1, MAP_MAX_SIZE);
+    map_size[1] = std::clamp(map_size[1], 1, MAP_MAX_SIZE);
+    ImGui::SameLine();
+    if (ImGui::Button(ICON_FA_EXPAND " Resize"))
+        map.resize(map_size[0], map_size[1]);
+    ImGui::Text("Map: %dx%d, %d chunks", map.width(), map.height(), (int)map.layers.chunk_count());
+
     // ---- Add texture at runtime(and reload textures folder)  ----
     if (ImGui::Button(ICON_FA_PLUS " Add Tilemap")) {
         ImGuiFileDialog::Instance()->OpenDialog("AddTextureDialog", "Select Texture",
@@ -81,7 +121,7 @@ void Editor::draw_tilemap_panel()
             }
 
             // Avoid duplicates
-            bool alreadyLoaded = std::find(map.textureNames.begin(), map.textureNames.end(), filePath) != map.textureNames.end();
+            bool alreadyLoaded = map.texture_index(filePath) >= 0;
             if (!alreadyLoaded) {
                 int idx = map.add_texture(destPath); // use the new add_texture()
                 if (idx >= 0) {
@@ -97,28 +137,29 @@ void Editor::draw_tilemap_panel()
     }
 
     // --- Draw current tilemap grid ---
-    Texture2D& tex = map.textures[selectedTextureIndex];
-    if (!tex.id) {
+    const AtlasSprite& tex = map.texture(selectedTextureIndex);
+    if (!tex.valid()) {
         ImGui::Text("Invalid texture");
         return;
     }
 
     // just for conflict with tilemaps previes
-    int new_tiles_x = tex.width / tile_width;
-    int new_tiles_y = tex.height / tile_height;
+    int new_tiles_x = tex.width() / tile_width;
+    int new_tiles_y = tex.height() / tile_height;
     if (new_tiles_x != tiles_x || new_tiles_y != tiles_y) {
         load_tilemap(tex, tile_width, tile_height);
     }
 
     for (int y = 0; y < tiles_y; ++y) {
         for (int x = 0; x < tiles_x; ++x) {
+            // UVs are relative to the whole atlas page
             ImVec2 uv0 = {
-                (float)(x * tile_width) / tex.width,
-                (float)(y * tile_height) / tex.height
+                (tex.rect.x + x * tile_width) / tex.texture.width,
+                (tex.rect.y + y * tile_height) / tex.texture.height
             };
             ImVec2 uv1 = {
-                (float)((x + 1) * tile_width) / tex.width,
-                (float)((y + 1) * tile_height) / tex.height
+                (tex.rect.x + (x + 1) * tile_width) / tex.texture.width,
+                (tex.rect.y + (y + 1) * tile_height) / tex.texture.height
             };
 
             ImVec2 button_size(tile_width * 2, tile_height * 2);
@@ -129,7 +170,7 @@ void Editor::draw_tilemap_panel()
 
             std::string id = "tile_" + std::to_string(x) + "_" + std::to_string(y);
             if (ImGui::ImageButton(id.c_str(),
-                    (ImTextureID)(intptr_t)tex.id,
+                    (ImTextureID)(intptr_t)tex.texture.id,
                     button_size, uv0, uv1)) {
                 selected_index_x = x;
                 selected_index_y = y;
@@ -154,6 +195,86 @@ Rectangle Editor::get_selected_tile_rect() const
     };
 }
 
+void Editor::save(const std::string& path)
+{
+    // Maps that are already on disk only need their journal made durable
+    if (map.save_journal(path)) {
+        save_status = "Saved";
+        return;
+    }
+
+    map.save_async(path);
+    save_status = "Saving...";
+}
+
+void Editor::update(float delta)
+{
+    // Checked before polling so every save that touched the file is accounted for below
+    bool saving = map.saver.busy();
+    MapSaver::Result result;
+    while (map.poll_save(result)) {
+        if (result.kind != eSaveKind::Manual) {
+            if (result.ok)
+                TraceLog(LOG_INFO, "%s %s (%.2fs)", result.kind == eSaveKind::Autosave ? "Autosaved" : "Compacted", result.path.c_str(), result.seconds);
+            continue;
+        }
+
+        if (result.ok) {
+            map.saved_version = result.version;
+            map.saved_entity_version = result.entity_version;
+            save_status = TextFormat("Saved (%.1f KB, %.2fs)", result.bytes / 1024.0, result.seconds);
+            TraceLog(LOG_INFO, "Map saved successfully: %s", result.path.c_str());
+        } else {
+            save_status = "Save failed!";
+        }
+    }
+
+    if (reload_pending && !saving) {
+        reload_pending = false;
+        bool outside = map.changed_on_disk(currentFilePath); // our own saves don't count
+        if (outside && map.has_unsaved_changes()) {
+            save_status = "Changed on disk, unsaved edits kept";
+            TraceLog(LOG_WARNING, "%s changed on disk, not reloading over unsaved edits", currentFilePath.c_str());
+        } else if (outside && map.reload_from_disk(currentFilePath)) {
+            save_status = "Reloaded from disk";
+        }
+    }
+
+    // One journal frame per editor frame
+    map.journal.flush();
+    if (map.journal.should_compact() && !map.saver.busy())
+        map.compact();
+
+    autosave_timer += delta;
+    if (autosave_timer < autosave_interval)
+        return;
+    autosave_timer = 0.0f;
+
+    // Journaled maps already survive a crash, unless entities changed
+    uint64_t version = map.layers.version() + map.entities.version;
+    bool journaled = map.journal.is_open() && map.entities.version == map.saved_entity_version;
+    if (journaled || !map.has_unsaved_changes() || version == autosaved_version || map.saver.busy())
+        return;
+
+    std::string path = currentFilePath.empty() ? std::string(RESOURCES_PATH "autosave.bin") : currentFilePath + ".autosave";
+    map.save_async(path, eSaveKind::Autosave);
+    autosaved_version = version;
+}
+
+void Editor::file_changed(const std::string& path)
+{
+    if (!currentFilePath.empty() && path == currentFilePath)
+        reload_pending = true;
+}
+
+void Editor::draw_save_status()
+{
+    if (map.saver.busy())
+        ImGui::TextDisabled("Saving...");
+    else if (!save_status.empty())
+        ImGui::TextDisabled("%s%s", save_status.c_str(), map.has_unsaved_changes() ? " *" : "");
+}
+
 void Editor::draw_editor_bar()
 {
     if (ImGui::BeginMenu("File")) {
@@ -162,7 +283,7 @@ void Editor::draw_editor_bar()
 
         if (ImGui::MenuItem("Save")) {
             if (!currentFilePath.empty())
-                map.save_to_file(currentFilePath);
+                save(currentFilePath);
             else
                 saveDialogOpen = true; // trigger Save As dialog
         }
@@ -187,7 +308,7 @@ void Editor::draw_editor_bar()
         if (ImGuiFileDialog::Instance()->Display("SaveAsDlgKey")) {
             if (ImGuiFileDialog::Instance()->IsOk()) {
                 currentFilePath = ImGuiFileDialog::Instance()->GetFilePathName();
-                map.save_to_file(currentFilePath);
+                save(currentFilePath);
             }
             ImGuiFileDialog::Instance()->Close();
             saveDialogOpen = false;
@@ -231,9 +352,9 @@ void Editor::draw_editor_bar()
 
 void Editor::reset_map()
 {
-    for (int x = 0; x < WORLD_WIDTH; ++x)
-        for (int y = 0; y < WORLD_HEIGHT; ++y)
-            map.editor_map[x][y].type = -1;
+    map.journal.close();
+    map.layers.clear();
+    map.entities.clear();
 
     currentFilePath.clear();
 }
@@ -251,7 +372,7 @@ void Editor::open_save_as_dialog()
         if (ImGuiFileDialog::Instance()->IsOk()) {
             std::string filePathName = ImGuiFileDialog::Instance()->GetFilePathName();
             currentFilePath = filePathName;
-            map.save_to_file(currentFilePath);
+            save(currentFilePath);
         }
         ImGuiFileDialog::Instance()->Close();
         saveDialogOpen = false;
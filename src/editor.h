@@ -1,5 +1,6 @@
 #pragma once
 
+#include "texture_atlas.h"
 #include "tile.h"
 #include <imgui.h>
 #include <raylib.h>
@@ -7,6 +8,7 @@
 #include <string>
 
 class Map;
+class PrefabLibrary;
 
 class Editor {
 
@@ -27,18 +29,41 @@ public:
     int selected_index_y = 0;
     bool cancel_tile_mode = false;
     bool fill_all_mode = false;
+    // Layer painted on, and per-layer toggles. Hidden or locked layers aren't painted.
+    int active_layer = LAYER_GROUND;
+    bool layer_visible[LAYER_COUNT] = { true, true, true, true };
+    bool layer_locked[LAYER_COUNT] = {};
+    // Entity mode places prefabs instead of painting tiles, cancel mode erases them
+    const PrefabLibrary* prefabs = nullptr; // set by the game
+    bool entity_mode = false;
+    int selected_prefab = 0;
+    int placement_zone = (int)eZone::ALL;
+    // Size applied by the "Resize" button, in tiles
+    int map_size[2] = { WORLD_WIDTH, WORLD_HEIGHT };
 
     bool saveDialogOpen = false;
     bool loadDialogOpen = false;
     std::string currentFilePath;
     Map& map;
+    // Unsaved edits of maps without a journal are written to <map>.autosave (or autosave.bin when untitled) this often, in seconds
+    float autosave_interval = 60.0f;
+    float autosave_timer = 0.0f;
+    uint64_t autosaved_version = 0;
+    std::string save_status;
+    bool reload_pending = false; // the open map changed on disk, handled by update()
     int selectedTextureIndex = 0;
 
-    void load_tilemap(Texture2D& tex, int tileW, int tileH);
+    void load_tilemap(const AtlasSprite& tex, int tileW, int tileH);
     void draw_tilemap_panel();
     void draw_editor_bar();
+    void draw_save_status();
+    // Collects finished background saves, flushes the journal and runs the autosave timer
+    void update(float delta);
+    // Called with files the watcher saw change, reloads the open map unless it has unsaved edits
+    void file_changed(const std::string& path);
 
     void reset_map();
+    void save(const std::string& path);
     void open_save_as_dialog();
     void open_load_dialog();
 
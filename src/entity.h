@@ -1,5 +1,6 @@
 #pragma once
 
+#include "hitbox_store.h"
 #include "sprite_animation.h"
 #include "tile.h"
 #include <raylib.h>
@@ -23,6 +24,9 @@ public:
     bool hasAnimation = false;
     bool show_hitbox = false;
 
+    uint32_t collision_layer = COLLIDE_PROP;
+    uint32_t collision_mask = COLLIDE_ALL; // layers this entity collides with
+
     Entity(std::string n = "", int x = 0, int y = 0, eZone z = eZone::ALL, float s = 1.f, bool pass_through = true)
         : name(std::move(n))
         , x_index(x)
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// Reference to a World entity: slot index and the slot's generation when it was handed out.
+// Once the entity is destroyed its handle is no longer alive(), even after the slot is reused.
+struct EntityHandle {
+    static constexpr uint32_t INDEX_BITS = 20;
+    static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    uint32_t value = 0; // generations start at 1, so 0 is never a live entity
+
+    static EntityHandle make(uint32_t index, uint32_t generation) { return { generation << INDEX_BITS | index }; }
+    // Generation a slot gets after its entity is destroyed, never 0
+    static uint32_t next_generation(uint32_t generation)
+    {
+        generation = (generation + 1) & GENERATION_MASK;
+        return generation != 0 ? generation : 1;
+    }
+
+    uint32_t index() const { return value & INDEX_MASK; }
+    uint32_t generation() const { return value >> INDEX_BITS; }
+    explicit operator bool() const { return value != 0; }
+    bool operator==(EntityHandle other) const { return value == other.value; }
+    bool operator!=(EntityHandle other) const { return value != other.value; }
+};
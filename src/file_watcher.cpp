@@ -0,0 +1,160 @@
+#include "file_watcher.h"
+#include <filesystem>
+#include <raylib.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// How long a file has to stay untouched before it is reported
+static constexpr std::chrono::milliseconds SETTLE_TIME(150);
+
+FileWatcher::FileWatcher()
+{
+#ifdef __linux__
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_fd < 0 || wake_fd < 0) {
+        TraceLog(LOG_WARNING, "File watching unavailable, hot reload is off");
+        return;
+    }
+    thread = std::thread(&FileWatcher::run, this);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (thread.joinable()) {
+        uint64_t one = 1;
+        (void)!write(wake_fd, &one, sizeof(one));
+        thread.join();
+    }
+    if (inotify_fd >= 0)
+        close(inotify_fd);
+    if (wake_fd >= 0)
+        close(wake_fd);
+#endif
+}
+
+bool FileWatcher::watch(const std::string& directory, bool recursive)
+{
+    if (!thread.joinable())
+        return false;
+
+    std::string dir = directory;
+    if (!dir.empty() && dir.back() != '/')
+        dir += '/';
+    if (!add_watch(dir, recursive))
+        return false;
+
+    if (recursive) {
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(dir, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_directory(ec))
+                add_watch(it->path().string() + "/", true);
+        }
+    }
+    TraceLog(LOG_INFO, "Watching %s for changes", dir.c_str());
+    return true;
+}
+
+bool FileWatcher::add_watch(const std::string& directory, bool recursive)
+{
+#ifdef __linux__
+    int wd = inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR);
+    if (wd < 0) {
+        TraceLog(LOG_WARNING, "Can't watch %s", directory.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // The same directory always maps to the same descriptor, a recursive watch wins
+    auto it = watches.find(wd);
+    if (it == watches.end())
+        watches[wd] = { directory, recursive };
+    else
+        it->second.recursive |= recursive;
+    return true;
+#else
+    (void)directory;
+    (void)recursive;
+    return false;
+#endif
+}
+
+void FileWatcher::poll(std::vector<std::string>& changed)
+{
+    // The watcher only holds the lock briefly, a busy frame just picks the files up next time
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock() || ready.empty())
+        return;
+
+    changed.insert(changed.end(), ready.begin(), ready.end());
+    ready.clear();
+}
+
+void FileWatcher::run()
+{
+#ifdef __linux__
+    alignas(struct inotify_event) char buffer[16 * 1024];
+
+    for (;;) {
+        pollfd fds[2] = { { inotify_fd, POLLIN, 0 }, { wake_fd, POLLIN, 0 } };
+        // Sleep until something happens, or until the next settling file is due
+        int timeout = settling.empty() ? -1 : (int)SETTLE_TIME.count() / 2;
+        if (::poll(fds, 2, timeout) < 0)
+            continue;
+        if (fds[1].revents & POLLIN)
+            return;
+
+        if (fds[0].revents & POLLIN) {
+            ssize_t length;
+            while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+                for (char* p = buffer; p < buffer + length;) {
+                    const inotify_event* event = (const inotify_event*)p;
+                    p += sizeof(inotify_event) + event->len;
+
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        TraceLog(LOG_WARNING, "File watcher overflowed, some changes were missed");
+                        continue;
+                    }
+                    if (event->len == 0)
+                        continue;
+
+                    Watch watch;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        auto it = watches.find(event->wd);
+                        if (it == watches.end())
+                            continue;
+                        watch = it->second;
+                    }
+
+                    std::string path = watch.directory + event->name;
+                    if (event->mask & IN_ISDIR) {
+                        if (watch.recursive)
+                            add_watch(path + "/", true);
+                    } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                        settling[path] = Clock::now();
+                    }
+                }
+            }
+        }
+
+        Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = settling.begin(); it != settling.end();) {
+            if (now - it->second >= SETTLE_TIME) {
+                ready.insert(it->first);
+                it = settling.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+#endif
+}
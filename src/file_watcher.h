@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Watches directories for files that were written or moved into place, on a
+// background thread (inotify, Linux only; elsewhere watch() just fails).
+// Bursts of writes to the same file are reported once, after it has been
+// quiet for a moment. Paths are the watched directory joined with the file name.
+class FileWatcher {
+
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Watching the same directory again is a no-op. Recursive watches follow new subdirectories.
+    bool watch(const std::string& directory, bool recursive = false);
+    // Moves the files changed since the last call into changed, never blocks on the watcher thread
+    void poll(std::vector<std::string>& changed);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Watch {
+        std::string directory; // with a trailing '/'
+        bool recursive;
+    };
+
+    void run();
+    bool add_watch(const std::string& directory, bool recursive);
+
+    int inotify_fd = -1;
+    int wake_fd = -1; // written by the destructor to stop run()
+    std::thread thread;
+
+    std::mutex mutex;
+    std::unordered_map<int, Watch> watches; // by watch descriptor
+    std::unordered_set<std::string> ready; // settled, waiting for poll()
+
+    // Only touched by run()
+    std::unordered_map<std::string, Clock::time_point> settling;
+};
@@ -0,0 +1,36 @@
+#include "frame_arena.h"
+
+FrameArena::FrameArena(size_t blockSize)
+    : block_size(blockSize)
+{
+}
+
+void* FrameArena::allocate(size_t size, size_t align)
+{
+    while (current < blocks.size()) {
+        Block& block = blocks[current];
+        uintptr_t base = (uintptr_t)block.bytes.get();
+        size_t at = ((base + offset + align - 1) & ~(uintptr_t)(align - 1)) - base;
+        if (at + size <= block.size) {
+            used_bytes += at + size - offset;
+            offset = at + size;
+            return block.bytes.get() + at;
+        }
+        // The rest of this block stays unused until reset()
+        current++;
+        offset = 0;
+    }
+
+    // Out of blocks: a new one, bigger when this allocation wouldn't fit a normal one
+    size_t newSize = size + align > block_size ? size + align : block_size;
+    blocks.push_back({ std::make_unique<uint8_t[]>(newSize), newSize });
+    capacity_bytes += newSize;
+    return allocate(size, align);
+}
+
+void FrameArena::reset()
+{
+    current = 0;
+    offset = 0;
+    used_bytes = 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for data that only lives until the end of the frame. reset() keeps the blocks,
+// so once the arena has grown to a busy frame's size allocating is just moving an offset.
+// Nothing is destructed, only trivially destructible types go in.
+class FrameArena {
+
+public:
+    explicit FrameArena(size_t blockSize = 64 * 1024);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t size, size_t align);
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Everything allocated so far is gone
+    void reset();
+
+    size_t used() const { return used_bytes; }
+    size_t capacity() const { return capacity_bytes; }
+
+private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> bytes;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t block_size;
+    size_t current = 0; // block being filled
+    size_t offset = 0; // into blocks[current]
+    size_t used_bytes = 0;
+    size_t capacity_bytes = 0;
+};
@@ -1,38 +1,17 @@
 #include "game.h"
+#include "asset_pack.h"
 #include "editor.h"
+#include "image_cache.h"
 #include "imgui.h"
 #include "raylib.h"
 #include "tile.h"
+#include <algorithm>
+#include <filesystem>
 
 Game::Game()
     : player(3, 3, eZone::WORLD)
     , editor(map)
 {
-    auto chest = entity_registry.spawn<Entity>("chest", 6, 3, eZone::ALL);
-    chest->is_passable = false;
-    chest->health = 100;
-    chest->points = 100;
-
-    entity_registry.spawn<Entity>("gate", 7, 7, eZone::ALL);
-
-    auto skull = entity_registry.spawn<Entity>("skull", 18, 7, eZone::DUNGEON);
-    skull->is_passable = false;
-
-    auto explosion_f = entity_registry.spawn<Entity>("explosion_f", 9, 2, eZone::ALL);
-    explosion_f->hasAnimation = true;
-
-    auto explosion_d = entity_registry.spawn<Entity>("explosion_d", 11, 10, eZone::ALL, 2.0f);
-    explosion_d->hasAnimation = true;
-
-    auto trap1 = entity_registry.spawn<Entity>("trap1", 12, 5, eZone::WORLD);
-    trap1->hasAnimation = true;
-
-    auto trap2 = entity_registry.spawn<Entity>("trap2", 13, 5, eZone::WORLD);
-    trap2->hasAnimation = true;
-
-    auto trap3 = entity_registry.spawn<Entity>("trap3", 14, 5, eZone::WORLD);
-    trap3->hasAnimation = true;
-
     init_camera();
 }
 
@@ -44,34 +23,48 @@ void Game::game_startup()
     InitAudioDevice();
     gameView = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
 
+    // A cooked pack next to the executable replaces resources/ entirely
+    std::string pack = std::string(GetApplicationDirectory()) + "resources.pak";
+    if (FileExists(pack.c_str()))
+        asset_pack.open(pack);
+
+    // Sheets needed on the first frame are decoded on the loader's threads and uploaded here as they
+    // finish, tilesets are only registered and load the first time they are drawn
+    ImageLoader loader;
     map.init();
-    player.load();
+    player.load(loader);
+
+    sounds[SOUND_ATTACK] = assets.load_sound(RESOURCES_PATH "human_damage_3.wav");
+    sounds[SOUND_POINTS] = assets.load_sound(RESOURCES_PATH "win_sound.wav");
+
+    while (!loader.done() && !WindowShouldClose()) {
+        loader.pump();
+        draw_loading_screen(loader.progress());
+    }
     init_editor();
 
-    Image explosion_fImage = LoadImage(RESOURCES_PATH "explosion_1f.png");
-    Texture2D explosion_fTex = LoadTextureFromImage(explosion_fImage);
-    auto explosion_f = entity_registry.get("explosion_f");
-    explosion_f->baseAnim.init(explosion_fTex, 1, 8, 48, 0.15f, 1, true);
-    UnloadImage(explosion_fImage);
-
-    Image explosion_dImage = LoadImage(RESOURCES_PATH "explosion_1d.png");
-    Texture2D explosion_dTex = LoadTextureFromImage(explosion_dImage);
-    auto explosion_d = entity_registry.get("explosion_d");
-    explosion_d->baseAnim.init(explosion_dTex, 1, 12, 128, 0.15f, 1, true);
-    UnloadImage(explosion_dImage);
-
-    Image trapImage = LoadImage(RESOURCES_PATH "trap.png");
-    Texture2D trapTex = LoadTextureFromImage(trapImage);
-    auto trap_1 = entity_registry.get("trap1");
-    auto trap_2 = entity_registry.get("trap2");
-    auto trap_3 = entity_registry.get("trap3");
-    trap_1->baseAnim.init(trapTex, 1, 8, 16, 0.15f, 1, true);
-    trap_2->baseAnim.init(trapTex, 1, 8, 16, 0.15f, 1, true);
-    trap_3->baseAnim.init(trapTex, 1, 8, 16, 0.15f, 1, true);
-    UnloadImage(trapImage);
-
-    sounds[SOUND_ATTACK] = LoadSound(RESOURCES_PATH "human_damage_3.wav");
-    sounds[SOUND_POINTS] = LoadSound(RESOURCES_PATH "win_sound.wav");
+    // Entities come from the start map's placements, built from the prefabs on the first update()
+    prefabs.load(RESOURCES_PATH "entities.prefabs");
+    editor.prefabs = &prefabs;
+    if (map.load_from_file(RESOURCES_PATH "start.bin"))
+        editor.currentFilePath = RESOURCES_PATH "start.bin";
+
+    if (!asset_pack.is_open())
+        watcher.watch(RESOURCES_PATH, true);
+}
+
+void Game::draw_loading_screen(float progress)
+{
+    int barWidth = GetScreenWidth() / 2;
+    int barX = (GetScreenWidth() - barWidth) / 2;
+    int barY = GetScreenHeight() / 2;
+
+    BeginDrawing();
+    ClearBackground(BLACK);
+    DrawText("Loading...", barX, barY - 30, 20, RAYWHITE);
+    DrawRectangle(barX, barY, (int)(barWidth * progress), 12, RAYWHITE);
+    DrawRectangleLines(barX, barY, barWidth, 12, GRAY);
+    EndDrawing();
 }
 
 void Game::init_camera()
@@ -83,7 +76,7 @@ void Game::init_camera()
 
     editor_camera = { 0 };
     editor_camera.zoom = 2.0f;
-    editor_camera.target = { WORLD_WIDTH * TILE_WIDTH / 2.0f, WORLD_HEIGHT * TILE_HEIGHT / 2.0f };
+    editor_camera.target = { map.width() * TILE_WIDTH / 2.0f, map.height() * TILE_HEIGHT / 2.0f };
     editor_camera.offset = { viewportWidth / 2.0f, viewportHeight / 2.0f };
 }
 
@@ -91,7 +84,37 @@ void Game::init_editor()
 {
     if (map.textures.size() > 0) {
         editor.selectedTextureIndex = 0;
-        editor.load_tilemap(map.textures[0], 16, 16);
+        editor.load_tilemap(map.texture(0), 16, 16);
+    }
+}
+
+void Game::hot_reload()
+{
+    // The open map may live outside resources/
+    if (!editor.currentFilePath.empty()) {
+        std::string dir = std::filesystem::path(editor.currentFilePath).parent_path().string();
+        if (dir != watched_map_dir && watcher.watch(dir))
+            watched_map_dir = dir;
+    }
+
+    std::vector<std::string> changed;
+    watcher.poll(changed);
+    for (const std::string& path : changed) {
+        if (IsFileExtension(path.c_str(), ".prefabs")) {
+            // Live entities keep the components they were made with, so make them again
+            if (prefabs.load(path))
+                prefabs_reloaded = true;
+            continue;
+        }
+        if (!IsFileExtension(path.c_str(), ".png")) {
+            editor.file_changed(path);
+            continue;
+        }
+        // Same handle, so map tiles and SpriteAnimations pick the new pixels up as they draw
+        if (assets.reload(path))
+            continue;
+        if (path.rfind(RESOURCES_PATH "tilemaps/", 0) == 0 && map.add_texture(path) >= 0)
+            TraceLog(LOG_INFO, "Registered tilemap: %s", path.c_str());
     }
 }
 
@@ -108,15 +131,22 @@ void Game::update(float delta)
     if (IsKeyPressed(KEY_R))
         debugMode = !debugMode;
 
+    hot_reload();
+    editor.update(delta);
+    assets.update();
+
     if (IsKeyPressed(KEY_F))
         free_cam = !free_cam;
 
     if (state == eState::Game) {
 
+        map.collision.update(map.layers[LAYER_COLLISION]);
         player.update(delta, *this);
 
-        for (auto& e : entity_registry.get_all())
-            e->update(delta);
+        animate(world, delta);
+        expire(world, commands, delta);
+        sync_hitboxes(world);
+        trigger_traps();
 
         if (free_cam) {
             float cameraSpeed = 200.0f * delta;
@@ -147,7 +177,7 @@ void Game::update(float delta)
             if (IsKeyDown(KEY_DOWN))
                 editor_camera.target.y += cameraSpeed;
         } else {
-            editor_camera.target = { WORLD_WIDTH * TILE_WIDTH / 2.0f, WORLD_HEIGHT * TILE_HEIGHT / 2.0f };
+            editor_camera.target = { map.width() * TILE_WIDTH / 2.0f, map.height() * TILE_HEIGHT / 2.0f };
         }
     }
 
@@ -168,25 +198,42 @@ void Game::update(float delta)
             activeCam->zoom = 12.0f;
     }
 
-    // Simple collision
-    if (CheckCollisionRecs(player.hitbox, entity_registry.get("chest")->hitbox)) {
-        // PlaySound(sounds[SOUND_ATTACK]);
-    }
+    // Bake dirty map chunks now, the draw pass runs inside gameView's texture mode
+    map.tile_batch.new_frame();
+    map.bake_chunks(map.visible_tiles(*activeCam, (float)gameView.texture.width, (float)gameView.texture.height));
 
     if (IsKeyPressed(KEY_E)) {
-        // if (player.x_index == gate.x_index && player.y_index == gate.y_index) {
-        if (CheckCollisionRecs(player.hitbox, entity_registry.get("gate")->hitbox)) {
-            if (player.zone == eZone::WORLD)
-                player.zone = eZone::DUNGEON;
-
-            else if (player.zone == eZone::DUNGEON)
-                player.zone = eZone::WORLD;
-
-            PlaySound(sounds[SOUND_POINTS]);
+        HitboxFilter inZone;
+        inZone.zones = HitboxFilter::zone_bits(player.zone);
+        nearby.clear();
+        world.query(player.hitbox, inZone, nearby);
+        for (EntityHandle handle : nearby) {
+            const Portal* portal = world.get<Portal>(handle);
+            if (!portal || (player.zone != portal->a && player.zone != portal->b))
+                continue;
+            player.zone = player.zone == portal->a ? portal->b : portal->a;
+            assets.play(sounds[SOUND_POINTS]);
+            break;
         }
     }
 
     handle_entity_selection();
+
+    // Sync point: entities spawned and destroyed during the frame come and go here, in one batch
+    commands.apply();
+    spawn_map_entities();
+}
+
+void Game::spawn_map_entities()
+{
+    if (!prefabs_reloaded && map.entities.version == spawned_entities)
+        return;
+    // Placements are edited rarely, rebuilding everything is simpler than diffing
+    world.clear();
+    selected_entity = {};
+    prefabs.instantiate(world, map.entities);
+    spawned_entities = map.entities.version;
+    prefabs_reloaded = false;
 }
 
 void Game::draw()
@@ -195,43 +242,35 @@ void Game::draw()
 
         BeginMode2D(camera);
 
-        map.draw_grid(WORLD_WIDTH, WORLD_HEIGHT, TILE_WIDTH, TILE_HEIGHT, 1.0f, BLACK);
-        map.draw();
+        // Only tiles inside the camera view are drawn
+        TileRect visible = map.visible_tiles(camera, (float)gameView.texture.width, (float)gameView.texture.height);
+        map.draw_grid(visible, TILE_WIDTH, TILE_HEIGHT, 1.0f, BLACK);
+        map.draw(visible, LAYER_GROUND);
+        map.draw(visible, LAYER_DECORATION);
 
-        for (auto& e : entity_registry.get_all()) {
-            // Only draw if visible in current zone
-            if (e->zone == eZone::ALL || e->zone == player.zone) {
-                if (e->hasAnimation) {
-                    // Animated entities use their own draw()
-                    e->draw();
-                } else {
-                    // Static entities use map tiles
-                    if (e->name == "chest")
-                        map.draw_tile(e->x_index * 16, e->y_index * 16, 7, 1, "dungeon_test");
-                    else if (e->name == "gate")
-                        map.draw_tile(e->x_index * TILE_WIDTH, e->y_index * TILE_HEIGHT, 2, 2, "dungeon_test");
-                    else if (e->name == "skull")
-                        map.draw_tile(e->x_index * TILE_WIDTH, e->y_index * TILE_HEIGHT, 1, 5, "dungeon_test");
-                }
-            }
-        }
+        view = {
+            (float)(visible.x0 * TILE_WIDTH), (float)(visible.y0 * TILE_HEIGHT),
+            (float)((visible.x1 - visible.x0) * TILE_WIDTH), (float)((visible.y1 - visible.y0) * TILE_HEIGHT)
+        };
+        draw_sprites(world, view, player.zone);
+        draw_animations(world, view, player.zone);
 
         player.draw();
 
+        // Roofs and treetops cover the player
+        map.draw(visible, LAYER_OVERHEAD);
+
         if (debugMode) {
+            map.draw_collision(visible);
             player.draw_hitbox(RED);
+            draw_hitboxes(world, view, BLUE);
 
-            for (auto& e : entity_registry.get_all()) {
-                e->show_hitbox = true;
-                e->draw_hitbox(BLUE);
-            }
-
-            map.draw_grid(WORLD_WIDTH, WORLD_HEIGHT, TILE_WIDTH, TILE_HEIGHT, 0.5f, RED);
+            map.draw_grid(visible, TILE_WIDTH, TILE_HEIGHT, 0.5f, RED);
             draw_mouse_highlight();
         }
 
-        if (selected_entity) {
-            DrawRectangleLinesEx(selected_entity->hitbox, 1, YELLOW);
+        if (const Hitbox* selected = world.get<Hitbox>(selected_entity)) {
+            DrawRectangleLinesEx(selected->rect, 1, YELLOW);
         }
 
         EndMode2D();
@@ -240,7 +279,8 @@ void Game::draw()
 
         BeginMode2D(editor_camera);
         EditorViewport view { viewport.x, viewport.y, viewport.width, viewport.height };
-        map.draw_editor_map(view, editor, editor_camera);
+        TileRect visible = map.visible_tiles(editor_camera, (float)gameView.texture.width, (float)gameView.texture.height);
+        map.draw_editor_map(view, editor, editor_camera, visible);
         // draw_mouse_highlight();
         EndMode2D();
     }
@@ -248,20 +288,52 @@ void Game::draw()
     draw_overlay();
 }
 
-bool Game::can_move_to(const Rectangle& nextHitbox)
+void Game::spawn_crowd(int count)
 {
-    for (auto& e : entity_registry.get_all()) {
-        if ((e->zone == player.zone || e->zone == eZone::ALL)
-            && !e->is_passable
-            && e->is_alive
-            && CheckCollisionRecs(nextHitbox, e->hitbox)) {
-            return false;
-        }
+    int trap = prefabs.find("trap");
+    if (trap < 0)
+        return;
+
+    for (int i = 0; i < count; ++i) {
+        EntityHandle handle = prefabs.instantiate(world, trap, GetRandomValue(0, map.width() - 1), GetRandomValue(0, map.height() - 1), player.zone);
+        Animation* anim = world.get<Animation>(handle);
+        if (anim)
+            anim->frame = GetRandomValue(0, anim->cols - 1);
     }
+}
 
-    // Optional: check map tiles too if needed
+void Game::trigger_traps()
+{
+    int explosion = prefabs.find("explosion_f");
+    if (explosion < 0)
+        return;
+    const Animation& anim = std::get<Animation>(prefabs[explosion].values);
+    Lifetime lifetime { anim.frame_time * anim.cols };
+
+    // Only the traps in the cells the player covers are looked at
+    HitboxFilter traps;
+    traps.zones = HitboxFilter::zone_bits(player.zone);
+    traps.layers = COLLIDE_TRAP;
+    nearby.clear();
+    world.query(player.hitbox, traps, nearby);
+    for (EntityHandle trap : nearby) {
+        const Rectangle& box = world.get<Hitbox>(trap)->rect;
+        const Zone* zone = world.get<Zone>(trap);
+
+        // Both happen at the end of the frame, with the rest of the frame's changes
+        commands.destroy(trap);
+        EntityHandle made = commands.spawn_from(prefabs[explosion].signature, prefabs.make(explosion, box.x, box.y, zone ? zone->zone : eZone::ALL));
+        commands.set(made, lifetime);
+    }
+}
+
+bool Game::can_move_to(const Rectangle& nextHitbox)
+{
+    if (blocked(world, nextHitbox, player.zone, player.collision_mask))
+        return false;
 
-    return true;
+    // Merged wall rectangles, a few boxes per chunk instead of one per tile
+    return !map.collision.overlaps(nextHitbox);
 }
 
 void Game::handle_entity_selection()
@@ -286,79 +358,96 @@ void Game::handle_entity_selection()
                 (state == eState::Editor) ? editor_camera : camera);
 
             // Detect clicked entity
-            selected_entity = nullptr;
-            for (auto& e : entity_registry.get_all()) {
-                if (CheckCollisionPointRec(mouseWorld, e->hitbox)) {
-                    selected_entity = e.get();
-                    break;
-                }
-            }
+            selected_entity = world.pick(mouseWorld, HitboxFilter {});
         }
     }
 }
 
 void Game::draw_entity_panel()
 {
-    // ImGui::Begin("Entities");
-
-    for (auto& e : entity_registry.get_all()) {
-        ImGui::PushID(e->name.c_str()); // Unique ID for each entity
-        // --- Set blue background for headers ---
-        // ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.2f, 0.4f, 0.8f, 0.8f)); // darker blue
-        // ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(0.3f, 0.5f, 1.0f, 0.9f)); // brighter hover
-        // ImGui::PushStyleColor(ImGuiCol_HeaderActive, ImVec4(0.1f, 0.3f, 0.7f, 1.0f)); // pressed blue
-
-        /*bool open = ImGui::CollapsingHeader(
-            e->name.c_str() //, ImGuiTreeNodeFlags_DefaultOpen
-        );*/
+    // Entities on screen, and the selected one wherever it is. Edits go through the command
+    // buffer when they change the World's layout, values are written in place.
+    // The view is most of the map, so one batched pass over every hitbox beats visiting its cells
+    std::vector<EntityHandle> listed;
+    world.hitboxes.overlaps(view, HitboxFilter {}, on_screen);
+    HitboxStore::for_each_hit(on_screen, [&](uint32_t slot) { listed.push_back(world.hitboxes.handle(slot)); });
+    if (world.alive(selected_entity) && std::find(listed.begin(), listed.end(), selected_entity) == listed.end())
+        listed.push_back(selected_entity);
+
+    for (EntityHandle handle : listed) {
+        const PrefabRef* ref = world.get<PrefabRef>(handle);
+        if (!ref || ref->prefab >= prefabs.size())
+            continue;
+        const Prefab& prefab = prefabs[ref->prefab];
+        ImGui::PushID((int)handle.value); // Unique ID for each entity
+
         bool open = false;
-        ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen;
-        if (selected_entity == e.get())
-            open = ImGui::CollapsingHeader(e->name.c_str(), ImGuiTreeNodeFlags_DefaultOpen);
+        std::string label = prefab.name + "##entity";
+        if (selected_entity == handle)
+            open = ImGui::CollapsingHeader(label.c_str(), ImGuiTreeNodeFlags_DefaultOpen);
         else
-            open = ImGui::CollapsingHeader(e->name.c_str());
+            open = ImGui::CollapsingHeader(label.c_str());
 
         if (ImGui::IsItemToggledOpen())
-            selected_entity = e.get();
-
-        // ImGui::PopStyleColor(3);
+            selected_entity = handle;
 
         if (open) {
             ImGui::Indent();
 
-            const char* zoneNames[] = { "ALL", "WORLD", "DUNGEON" };
-            int zoneIndex = static_cast<int>(e->zone);
-            if (ImGui::Combo("Zone", &zoneIndex, zoneNames, IM_ARRAYSIZE(zoneNames))) {
-                e->zone = static_cast<eZone>(zoneIndex);
+            if (Zone* zone = world.get<Zone>(handle)) {
+                const char* zoneNames[] = { "ALL", "WORLD", "DUNGEON" };
+                int zoneIndex = static_cast<int>(zone->zone);
+                if (ImGui::Combo("Zone", &zoneIndex, zoneNames, IM_ARRAYSIZE(zoneNames))) {
+                    zone->zone = static_cast<eZone>(zoneIndex);
+                    world.reindex(handle);
+                }
             }
-            // ImGui::Text("Zone: %d", static_cast<int>(e->zone));
 
-            ImGui::Checkbox("Alive", &e->is_alive);
-            ImGui::Checkbox("Passable", &e->is_passable);
+            if (Collider* collider = world.get<Collider>(handle)) {
+                if (ImGui::Checkbox("Blocking", &collider->blocking))
+                    world.reindex(handle);
+            }
 
-            ImGui::InputInt("Health", &e->health);
-            e->health = std::max(0, e->health);
-            ImGui::InputInt("Damage", &e->damage);
-            e->damage = std::max(0, e->damage);
-            ImGui::InputInt("Points", &e->points);
-            e->points = std::max(0, e->points);
+            if (Health* health = world.get<Health>(handle)) {
+                ImGui::InputInt("Health", &health->health);
+                health->health = std::max(0, health->health);
+                ImGui::InputInt("Damage", &health->damage);
+                health->damage = std::max(0, health->damage);
+                ImGui::InputInt("Points", &health->points);
+                health->points = std::max(0, health->points);
+            }
 
-            // ImGui::NewLine();
             ImGui::Separator();
-            ImGui::Text("Pos: (%d, %d)", e->x_index, e->y_index);
+            Position* pos = world.get<Position>(handle);
+            const Rectangle& hitbox = world.get<Hitbox>(handle)->rect;
+            int tileX = (int)(pos->x / TILE_WIDTH);
+            int tileY = (int)(pos->y / TILE_HEIGHT);
+            ImGui::Text("Pos: (%d, %d)", tileX, tileY);
             ImGui::Text("Hitbox: x=%.1f y=%.1f w=%.1f h=%.1f",
-                e->hitbox.x, e->hitbox.y, e->hitbox.width, e->hitbox.height);
-            ImGui::SliderInt("Pos X", &e->x_index, 0, WORLD_WIDTH);
-            ImGui::SliderInt("Pos Y##", &e->y_index, 0, WORLD_HEIGHT);
-            e->update_hitbox();
+                hitbox.x, hitbox.y, hitbox.width, hitbox.height);
+            // sync_hitboxes() moves the hitbox along next update
+            if (ImGui::SliderInt("Pos X", &tileX, 0, map.width()))
+                pos->x = (float)(tileX * TILE_WIDTH);
+            if (ImGui::SliderInt("Pos Y##", &tileY, 0, map.height()))
+                pos->y = (float)(tileY * TILE_HEIGHT);
+
+            if (ImGui::Button(ICON_FA_TRASH " Destroy"))
+                commands.destroy(handle);
 
-            // ImGui::NewLine();
             ImGui::Separator();
-            ImGui::Text("Animation Preview:");
-            if (e->hasAnimation) {
+            ImGui::Text("Sheet Preview:");
+            TextureHandle sheetHandle;
+            if (const Animation* anim = world.get<Animation>(handle))
+                sheetHandle = anim->sheet;
+            else if (const Sprite* sprite = world.get<Sprite>(handle))
+                sheetHandle = sprite->sheet;
+
+            if (sheetHandle.valid()) {
                 const float maxPreviewSize = 256.0f; // all previews fit in this square
-                float texW = static_cast<float>(e->baseAnim.texture.width);
-                float texH = static_cast<float>(e->baseAnim.texture.height);
+                const AtlasSprite& sheet = assets.sprite(sheetHandle);
+                const Rectangle& region = sheet.rect;
+                float texW = region.width;
+                float texH = region.height;
 
                 // Keep aspect ratio
                 float aspect = texW / texH;
@@ -381,13 +470,15 @@ void Game::draw_entity_panel()
                     p0, p1, /*IM_COL32(255, 0, 255, 255)*/ IM_COL32(0, 0, 0, 255));
 
                 // ImGui expects ImTextureID; with raylib, we cast the texture id
+                // Sprite sheet rect inside its atlas page
+                const Texture2D& page = sheet.texture;
                 ImGui::Image(
-                    (ImTextureID)(intptr_t)e->baseAnim.texture.id,
+                    (ImTextureID)(intptr_t)page.id,
                     size,
-                    ImVec2(0, 0),
-                    ImVec2(1, 1));
+                    ImVec2(region.x / page.width, region.y / page.height),
+                    ImVec2((region.x + region.width) / page.width, (region.y + region.height) / page.height));
             } else {
-                ImGui::TextDisabled("No animation texture.");
+                ImGui::TextDisabled("No sheet.");
             }
 
             ImGui::Unindent();
@@ -395,8 +486,6 @@ void Game::draw_entity_panel()
         }
         ImGui::PopID();
     }
-
-    // ImGui::End();
 }
 
 void Game::draw_ui()
@@ -431,12 +520,34 @@ void Game::draw_ui()
             ImGui::EndMenu();
         }
 
+        editor.draw_save_status();
+
         ImGui::EndMainMenuBar();
     }
 
     // ---- Debug Panel ----
     ImGui::Begin("Debug Panel");
     ImGui::Text("Camera: (%.2f, %.2f)", camera.target.x, camera.target.y);
+    ImGui::Text("Tile quads: %d, batches: %d", map.tile_batch.last.quads, map.tile_batch.last.batches);
+    ImGui::Text("Assets: %d textures, %d sounds", assets.texture_count(), assets.sound_count());
+    const AssetManager::Stats& residency = assets.stats();
+    ImGui::Text("Resident: %d textures, %.1f / %.1f MB", residency.resident, residency.resident_bytes / 1048576.0, assets.texture_budget / 1048576.0);
+    ImGui::Text("Texture hits: %llu, misses: %llu, loads: %d, evictions: %d",
+        (unsigned long long)residency.hits, (unsigned long long)residency.misses, residency.loads, residency.evictions);
+    int budgetMB = (int)(assets.texture_budget >> 20);
+    if (ImGui::SliderInt("Texture budget (MB)", &budgetMB, 1, 1024))
+        assets.texture_budget = (size_t)budgetMB << 20;
+    ImGui::Text("Atlas: %d pages, %d sprites", texture_atlas.page_count(), texture_atlas.sprite_count());
+    ImGui::Text("Image cache: %d hits, %d misses", image_cache_stats.hits.load(), image_cache_stats.misses.load());
+    ImGui::Text("Chunk cache: %d cached, %d hits, %d bakes", map.chunk_cache.stats.cached, map.chunk_cache.stats.hits, map.chunk_cache.stats.bakes);
+    ImGui::Text("Collision: %d rects", (int)map.collision.rect_count());
+    ImGui::Text("World: %d entities, %d archetypes", (int)world.size(), (int)world.archetype_count());
+    ImGui::Text("Frame arena: %.1f KB", commands.memory().capacity() / 1024.0);
+    if (ImGui::Button("Spawn 1000 traps"))
+        spawn_crowd(1000);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear world"))
+        world.clear();
     ImGui::TextUnformatted(ICON_FA_BOMB);
     ImGui::NewLine();
     map.draw_tilemap_previews(editor);
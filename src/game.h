@@ -1,15 +1,19 @@
 #pragma once
+#include "asset_manager.h"
 #include "editor.h"
 #include "entity.h"
-#include "entity_registry.h"
+#include "file_watcher.h"
 #include "map.h"
 #include "player.h"
+#include "prefab.h"
 #include "raylib.h"
+#include "systems.h"
+#include "world.h"
 #include <imgui.h>
 
 #define MAX_SOUNDS 2
 
-inline Sound sounds[MAX_SOUNDS]; // move in header
+inline SoundHandle sounds[MAX_SOUNDS]; // owned by the AssetManager
 
 typedef enum {
     SOUND_ATTACK = 0,
@@ -35,8 +39,22 @@ public:
     Map map;
     Editor editor;
     Player player;
-    Entity* selected_entity = nullptr;
-    EntityRegistry entity_registry;
+    EntityHandle selected_entity; // a World entity, no longer alive() once it's gone
+    // Entity definitions (resources/*.prefabs), instantiated from the map's placements
+    PrefabLibrary prefabs;
+    // Component storage for entities, updated and drawn by the passes in systems.h
+    World world;
+    // World changes made while systems iterate, applied at the end of update()
+    CommandBuffer commands { world };
+    uint64_t spawned_entities = 0; // map.entities.version the World was built from
+    bool prefabs_reloaded = true; // live PrefabRefs may index past the new library, rebuild regardless of version
+    Rectangle view = {}; // world area on screen last frame
+    std::vector<EntityHandle> nearby; // World::query() results, reused every frame
+    std::vector<uint64_t> on_screen; // HitboxStore::overlaps() bits, reused every frame
+
+    // resources/ and the folder of the open map, for hot reload
+    FileWatcher watcher;
+    std::string watched_map_dir;
 
     Camera2D camera;
     Camera2D editor_camera;
@@ -51,12 +69,22 @@ public:
     Game();
     ~Game() = default;
 
+    // Opens the window and loads every asset behind a loading screen
     void game_startup();
+    void draw_loading_screen(float progress);
     void init_camera();
     void init_editor();
     void update(float delta);
+    // Swaps in textures and maps that changed on disk
+    void hot_reload();
     void draw();
     bool can_move_to(const Rectangle& nextHitbox);
+    // Rebuilds the World from the map's placements when they changed
+    void spawn_map_entities();
+    // Debug load test: count animated traps scattered over the map in the player's zone
+    void spawn_crowd(int count);
+    // World traps the player stepped on go off: each is replaced by an explosion
+    void trigger_traps();
     void handle_entity_selection();
 
     void draw_overlay();
@@ -0,0 +1,150 @@
+#include "hitbox_store.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HITBOX_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+int HitboxStore::count_trailing_zeros(uint64_t v)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return (int)index;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+void HitboxStore::update(EntityHandle handle, const Rectangle& box, eZone entityZone, uint32_t entityLayer, uint32_t entityFlags)
+{
+    uint32_t slot = this->slot(handle);
+    if (slot == NONE) {
+        uint32_t index = handle.index();
+        if (index >= slot_of.size())
+            slot_of.resize(index + 1, NONE);
+        slot = (uint32_t)owner.size();
+        slot_of[index] = slot;
+        owner.push_back(handle);
+        x0.push_back(0);
+        y0.push_back(0);
+        x1.push_back(0);
+        y1.push_back(0);
+        zone.push_back(0);
+        layer.push_back(0);
+        flags.push_back(0);
+    }
+    x0[slot] = box.x;
+    y0[slot] = box.y;
+    x1[slot] = box.x + box.width;
+    y1[slot] = box.y + box.height;
+    zone[slot] = 1u << (int)entityZone;
+    layer[slot] = entityLayer;
+    flags[slot] = entityFlags;
+}
+
+void HitboxStore::remove(EntityHandle handle)
+{
+    uint32_t slot = this->slot(handle);
+    if (slot == NONE)
+        return;
+
+    uint32_t last = (uint32_t)owner.size() - 1;
+    if (slot != last) {
+        owner[slot] = owner[last];
+        x0[slot] = x0[last];
+        y0[slot] = y0[last];
+        x1[slot] = x1[last];
+        y1[slot] = y1[last];
+        zone[slot] = zone[last];
+        layer[slot] = layer[last];
+        flags[slot] = flags[last];
+        slot_of[owner[slot].index()] = slot;
+    }
+    owner.pop_back();
+    x0.pop_back();
+    y0.pop_back();
+    x1.pop_back();
+    y1.pop_back();
+    zone.pop_back();
+    layer.pop_back();
+    flags.pop_back();
+    slot_of[handle.index()] = NONE;
+}
+
+void HitboxStore::clear()
+{
+    for (EntityHandle handle : owner)
+        slot_of[handle.index()] = NONE;
+    owner.clear();
+    x0.clear();
+    y0.clear();
+    x1.clear();
+    y1.clear();
+    zone.clear();
+    layer.clear();
+    flags.clear();
+}
+
+void HitboxStore::overlaps(const Rectangle& box, const HitboxFilter& filter, std::vector<uint64_t>& hits) const
+{
+    const size_t n = owner.size();
+    hits.assign((n + 63) / 64, 0);
+
+    // Same test as CheckCollisionRecs: edges that only touch don't overlap
+    const float qx0 = box.x, qy0 = box.y, qx1 = box.x + box.width, qy1 = box.y + box.height;
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256 vqx0 = _mm256_set1_ps(qx0), vqy0 = _mm256_set1_ps(qy0);
+    const __m256 vqx1 = _mm256_set1_ps(qx1), vqy1 = _mm256_set1_ps(qy1);
+    const __m256i zones = _mm256_set1_epi32((int)filter.zones);
+    const __m256i layers = _mm256_set1_epi32((int)filter.layers);
+    const __m256i required = _mm256_set1_epi32((int)filter.flags);
+    const __m256i zero = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8) {
+        __m256 inside = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(vqx0, _mm256_loadu_ps(&x1[i]), _CMP_LT_OQ), _mm256_cmp_ps(vqx1, _mm256_loadu_ps(&x0[i]), _CMP_GT_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(vqy0, _mm256_loadu_ps(&y1[i]), _CMP_LT_OQ), _mm256_cmp_ps(vqy1, _mm256_loadu_ps(&y0[i]), _CMP_GT_OQ)));
+        // Lanes where a masked column is zero fail, as do lanes missing a required flag
+        __m256i rejected = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_loadu_si256((const __m256i*)&zone[i]), zones), zero),
+                _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_loadu_si256((const __m256i*)&layer[i]), layers), zero)),
+            _mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_loadu_si256((const __m256i*)&flags[i]), required), required), _mm256_set1_epi32(-1)));
+        uint64_t bits = (uint32_t)_mm256_movemask_ps(_mm256_andnot_ps(_mm256_castsi256_ps(rejected), inside));
+        hits[i >> 6] |= bits << (i & 63);
+    }
+#elif defined(HITBOX_SSE2)
+    const __m128 vqx0 = _mm_set1_ps(qx0), vqy0 = _mm_set1_ps(qy0);
+    const __m128 vqx1 = _mm_set1_ps(qx1), vqy1 = _mm_set1_ps(qy1);
+    const __m128i zones = _mm_set1_epi32((int)filter.zones);
+    const __m128i layers = _mm_set1_epi32((int)filter.layers);
+    const __m128i required = _mm_set1_epi32((int)filter.flags);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= n; i += 4) {
+        __m128 inside = _mm_and_ps(
+            _mm_and_ps(_mm_cmplt_ps(vqx0, _mm_loadu_ps(&x1[i])), _mm_cmpgt_ps(vqx1, _mm_loadu_ps(&x0[i]))),
+            _mm_and_ps(_mm_cmplt_ps(vqy0, _mm_loadu_ps(&y1[i])), _mm_cmpgt_ps(vqy1, _mm_loadu_ps(&y0[i]))));
+        __m128i rejected = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128((const __m128i*)&zone[i]), zones), zero),
+                _mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128((const __m128i*)&layer[i]), layers), zero)),
+            _mm_xor_si128(_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128((const __m128i*)&flags[i]), required), required), _mm_set1_epi32(-1)));
+        uint64_t bits = (uint32_t)_mm_movemask_ps(_mm_andnot_ps(_mm_castsi128_ps(rejected), inside));
+        hits[i >> 6] |= bits << (i & 63);
+    }
+#endif
+
+    // Scalar fallback, and the tail the vector loop didn't cover
+    for (; i < n; ++i) {
+        bool hit = qx0 < x1[i] && qx1 > x0[i] && qy0 < y1[i] && qy1 > y0[i]
+            && (zone[i] & filter.zones) && (layer[i] & filter.layers) && (flags[i] & filter.flags) == filter.flags;
+        if (hit)
+            hits[i >> 6] |= 1ull << (i & 63);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "entity_handle.h"
+#include "tile.h"
+#include <cstdint>
+#include <raylib.h>
+#include <vector>
+
+// What an entity is, for hitbox queries. An entity matches a query when its layer is in the query's mask.
+enum eCollisionLayer : uint32_t {
+    COLLIDE_NONE = 0,
+    COLLIDE_PROP = 1 << 0,
+    COLLIDE_NPC = 1 << 1,
+    COLLIDE_TRAP = 1 << 2,
+    COLLIDE_PICKUP = 1 << 3,
+    COLLIDE_ALL = 0xffffffffu,
+};
+
+enum eHitboxFlags : uint32_t {
+    HITBOX_ALIVE = 1 << 0,
+    HITBOX_BLOCKING = 1 << 1, // Collider::blocking
+};
+
+// Which hitboxes a batched test accepts: zone in zones, some bit of layer in layers, every bit of flags set
+struct HitboxFilter {
+    uint32_t zones = 0xffffffffu; // 1 << eZone
+    uint32_t layers = 0xffffffffu; // eCollisionLayer bits
+    uint32_t flags = 0; // eHitboxFlags that must be set
+
+    // Entities of zone plus those in every zone
+    static uint32_t zone_bits(eZone zone) { return 1u << (int)zone | 1u << (int)eZone::ALL; }
+};
+
+// Entity hitboxes, zones and flags in parallel arrays, so one query box is tested against
+// 4 (SSE2) or 8 (AVX2) hitboxes per instruction. Slots are dense, removal moves the last one in.
+// World keeps it in sync with its Hitbox, Zone and Collider components.
+class HitboxStore {
+
+public:
+    static constexpr uint32_t NONE = 0xffffffffu;
+
+    // Copies the entity's hitbox, zone, layer and flags into its slot, adding one the first time
+    void update(EntityHandle handle, const Rectangle& box, eZone zone, uint32_t layer, uint32_t flags);
+    void remove(EntityHandle handle);
+    void clear();
+
+    size_t size() const { return owner.size(); }
+    EntityHandle handle(uint32_t slot) const { return owner[slot]; }
+    // NONE when the entity isn't stored
+    uint32_t slot(EntityHandle handle) const
+    {
+        uint32_t index = handle.index();
+        return index < slot_of.size() && slot_of[index] != NONE && owner[slot_of[index]] == handle ? slot_of[index] : NONE;
+    }
+    Rectangle rect(uint32_t slot) const { return { x0[slot], y0[slot], x1[slot] - x0[slot], y1[slot] - y0[slot] }; }
+
+    // Sets bit i of hits (size() bits, rounded up to whole words) when slot i overlaps box and passes filter
+    void overlaps(const Rectangle& box, const HitboxFilter& filter, std::vector<uint64_t>& hits) const;
+    // The same test for one slot
+    bool overlaps(uint32_t slot, const Rectangle& box, const HitboxFilter& filter) const
+    {
+        return box.x < x1[slot] && box.x + box.width > x0[slot] && box.y < y1[slot] && box.y + box.height > y0[slot] && passes(slot, filter);
+    }
+    bool passes(uint32_t slot, const HitboxFilter& filter) const
+    {
+        return (zone[slot] & filter.zones) && (layer[slot] & filter.layers) && (flags[slot] & filter.flags) == filter.flags;
+    }
+
+    static bool test(const std::vector<uint64_t>& hits, uint32_t slot) { return (hits[slot >> 6] >> (slot & 63)) & 1; }
+    // fn(slot) for every bit set in hits, in slot order
+    template <typename Fn>
+    static void for_each_hit(const std::vector<uint64_t>& hits, Fn&& fn)
+    {
+        for (size_t w = 0; w < hits.size(); ++w) {
+            for (uint64_t bits = hits[w]; bits != 0; bits &= bits - 1)
+                fn((uint32_t)(w * 64 + count_trailing_zeros(bits)));
+        }
+    }
+
+private:
+    static int count_trailing_zeros(uint64_t v);
+
+    // Hitboxes as min/max corners, one subtraction less per test than x/y/width/height
+    std::vector<float> x0, y0, x1, y1;
+    std::vector<uint32_t> zone; // 1 << eZone
+    std::vector<uint32_t> layer;
+    std::vector<uint32_t> flags;
+    std::vector<EntityHandle> owner;
+    std::vector<uint32_t> slot_of; // by EntityHandle::index()
+};
@@ -0,0 +1,145 @@
+#include "image_cache.h"
+#include "mapped_file.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+static uint64_t fnv1a64(const uint8_t* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static const std::string& cache_dir()
+{
+    // GetApplicationDirectory returns a shared static buffer, read it once
+    static const std::string dir = [] {
+        std::string path = std::string(GetApplicationDirectory()) + "image_cache/";
+        std::error_code ec;
+        fs::create_directories(path, ec);
+        return path;
+    }();
+    return dir;
+}
+
+static std::string entry_path(uint64_t pathHash)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.img", (unsigned long long)pathHash);
+    return cache_dir() + name;
+}
+
+static uint64_t hash_file(const std::string& path, bool& ok)
+{
+    MappedFile file;
+    ok = file.open(path);
+    return ok ? fnv1a64(file.data(), file.size()) : 0;
+}
+
+static void write_entry(const std::string& entryPath, const ImageCacheHeader& header, const Image& image)
+{
+    // Unique temp name so two threads decoding the same file can't interleave
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%zx.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::string tmpPath = entryPath + suffix;
+
+    FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file)
+        return;
+
+    size_t pixels = (size_t)image.width * image.height * 4;
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && std::fwrite(image.data, 1, pixels, file) == pixels;
+    ok = (std::fclose(file) == 0) && ok;
+
+    std::error_code ec;
+    if (ok)
+        fs::rename(tmpPath, entryPath, ec);
+    if (!ok || ec)
+        fs::remove(tmpPath, ec);
+}
+
+static void rewrite_header(const std::string& entryPath, const ImageCacheHeader& header)
+{
+    FILE* file = std::fopen(entryPath.c_str(), "r+b");
+    if (!file)
+        return;
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fclose(file);
+}
+
+Image load_image_cached(const std::string& path)
+{
+    std::error_code ec;
+    uint64_t sourceSize = fs::file_size(path, ec);
+    if (ec)
+        return LoadImage(path.c_str()); // let raylib report it
+
+    int64_t sourceMtime = fs::last_write_time(path, ec).time_since_epoch().count();
+    uint64_t pathHash = fnv1a64((const uint8_t*)path.data(), path.size());
+    std::string entryPath = entry_path(pathHash);
+
+    MappedFile entry;
+    if (entry.open(entryPath) && entry.size() >= sizeof(ImageCacheHeader)) {
+        ImageCacheHeader header;
+        std::memcpy(&header, entry.data(), sizeof(header));
+        size_t pixels = (size_t)header.width * header.height * 4;
+
+        bool valid = header.magic == IMAGE_CACHE_MAGIC && header.version == IMAGE_CACHE_VERSION
+            && header.path_hash == pathHash && header.source_size == sourceSize
+            && header.width > 0 && header.height > 0 && entry.size() == sizeof(header) + pixels;
+
+        // Touched but maybe not changed (checkout, copy), compare contents
+        bool touched = valid && header.source_mtime != sourceMtime;
+        if (touched) {
+            bool ok;
+            valid = hash_file(path, ok) == header.content_hash && ok;
+        }
+
+        if (valid) {
+            Image image = {};
+            image.data = RL_MALLOC(pixels);
+            std::memcpy(image.data, entry.data() + sizeof(header), pixels);
+            image.width = header.width;
+            image.height = header.height;
+            image.mipmaps = 1;
+            image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+            entry.close();
+
+            if (touched) {
+                header.source_mtime = sourceMtime;
+                rewrite_header(entryPath, header);
+            }
+            image_cache_stats.hits++;
+            return image;
+        }
+    }
+    entry.close();
+
+    image_cache_stats.misses++;
+    Image image = LoadImage(path.c_str());
+    if (image.data == nullptr)
+        return image;
+    if (image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+        ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+    bool hashed;
+    ImageCacheHeader header = {};
+    header.magic = IMAGE_CACHE_MAGIC;
+    header.version = IMAGE_CACHE_VERSION;
+    header.width = image.width;
+    header.height = image.height;
+    header.path_hash = pathHash;
+    header.source_size = sourceSize;
+    header.source_mtime = sourceMtime;
+    header.content_hash = hash_file(path, hashed);
+    if (hashed && image.mipmaps == 1)
+        write_entry(entryPath, header, image);
+    return image;
+}
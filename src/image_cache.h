@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <raylib.h>
+#include <string>
+
+/*
+Decoded pixels of every image loaded through load_image_cached() are kept in
+<app dir>/image_cache/<hash of path>.img so later launches skip PNG decoding:
+
+    ImageCacheHeader
+    [u8...] RGBA8 pixels, width * height * 4
+
+An entry is used as is when the source size and mtime match. When only the
+mtime differs the source is hashed and the entry kept if the content is unchanged.
+*/
+
+constexpr uint32_t IMAGE_CACHE_MAGIC = 0x49475052; // "RPGI"
+constexpr uint16_t IMAGE_CACHE_VERSION = 1;
+
+struct ImageCacheHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    int32_t width;
+    int32_t height;
+    uint64_t path_hash; // guards against two paths sharing a file name
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t content_hash; // FNV-1a of the source file
+};
+
+static_assert(sizeof(ImageCacheHeader) == 48, "image cache header layout changed");
+
+struct ImageCacheStats {
+    std::atomic<int> hits { 0 };
+    std::atomic<int> misses { 0 };
+};
+inline ImageCacheStats image_cache_stats;
+
+// Drop-in LoadImage: RGBA8 pixels from the cache when the source is unchanged,
+// otherwise decodes the file and refreshes the entry. Safe to call from any thread.
+Image load_image_cached(const std::string& path);
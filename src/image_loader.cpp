@@ -0,0 +1,135 @@
+#include "image_loader.h"
+#include "asset_pack.h"
+#include "image_cache.h"
+#include <algorithm>
+
+ImageLoader::ImageLoader(int threads)
+{
+    if (threads <= 0)
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+
+    for (int i = 0; i < threads; ++i)
+        workers.emplace_back(&ImageLoader::run, this);
+}
+
+ImageLoader::~ImageLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        queue.clear();
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+
+    for (auto& batch : ready) {
+        for (Image& image : batch->images)
+            UnloadImage(image);
+    }
+}
+
+void ImageLoader::request(const std::string& path, Callback onLoaded)
+{
+    request_batch({ path }, [onLoaded](std::vector<Image>& images) { onLoaded(images[0]); });
+}
+
+void ImageLoader::request_batch(const std::vector<std::string>& paths, BatchCallback onLoaded)
+{
+    auto batch = std::make_shared<Batch>();
+    batch->paths = paths;
+    batch->images.resize(paths.size(), Image {});
+    batch->remaining = (int)paths.size();
+    batch->callback = std::move(onLoaded);
+
+    batches_total++;
+    images_total += (int)paths.size();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (paths.empty()) {
+        ready.push_back(batch);
+        return;
+    }
+    for (int i = 0; i < (int)paths.size(); ++i)
+        queue.push_back({ batch, i });
+    wake.notify_all();
+}
+
+void ImageLoader::run()
+{
+    for (;;) {
+        Work work;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return quit || !queue.empty(); });
+            if (quit)
+                return;
+
+            work = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        Batch& batch = *work.batch;
+        const std::string& path = batch.paths[work.index];
+        // Cooked textures only need copying out of the pack
+        Image image = asset_pack.load_image(path);
+        if (image.data == nullptr)
+            image = load_image_cached(path);
+        if (image.data == nullptr)
+            TraceLog(LOG_ERROR, "Failed to load texture: %s", path.c_str());
+        else if (image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+            ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+        // Each worker writes its own slot, the last one publishes the batch
+        batch.images[work.index] = image;
+        images_done++;
+        if (--batch.remaining == 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(std::move(work.batch));
+            ready_wake.notify_one();
+        }
+    }
+}
+
+int ImageLoader::pump(double budget)
+{
+    double start = GetTime();
+    int ran = 0;
+
+    for (;;) {
+        std::shared_ptr<Batch> batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ready.empty())
+                break;
+            batch = std::move(ready.front());
+            ready.pop_front();
+        }
+
+        batch->callback(batch->images);
+        for (Image& image : batch->images)
+            UnloadImage(image);
+        batches_done++;
+        ran++;
+
+        if (GetTime() - start >= budget)
+            break;
+    }
+    return ran;
+}
+
+void ImageLoader::finish()
+{
+    while (!done()) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready_wake.wait(lock, [this] { return !ready.empty(); });
+        }
+        pump(1e9);
+    }
+}
+
+float ImageLoader::progress() const
+{
+    return images_total > 0 ? (float)images_done / (float)images_total : 1.0f;
+}
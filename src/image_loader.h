@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <raylib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Decodes image files on a pool of worker threads. Finished images are handed
+// to their callbacks by pump(), which runs on the GL thread so callbacks can
+// upload them. Images are converted to RGBA8 on the workers and unloaded
+// after the callback returns.
+class ImageLoader {
+
+public:
+    using Callback = std::function<void(Image& image)>;
+    // images are in the order of paths, failed decodes have data == nullptr
+    using BatchCallback = std::function<void(std::vector<Image>& images)>;
+
+    // 0 threads means one per core
+    explicit ImageLoader(int threads = 0);
+    // Drops whatever hasn't been pumped yet
+    ~ImageLoader();
+
+    ImageLoader(const ImageLoader&) = delete;
+    ImageLoader& operator=(const ImageLoader&) = delete;
+
+    void request(const std::string& path, Callback onLoaded);
+    // onLoaded runs once every path of the batch is decoded
+    void request_batch(const std::vector<std::string>& paths, BatchCallback onLoaded);
+
+    // Runs callbacks of finished requests until budget seconds are spent, returns how many ran
+    int pump(double budget = 1.0 / 120.0);
+    // Blocks, pumping everything
+    void finish();
+
+    bool done() const { return batches_done == batches_total; }
+    // Fraction of images decoded
+    float progress() const;
+
+private:
+    struct Batch {
+        std::vector<std::string> paths;
+        std::vector<Image> images;
+        std::atomic<int> remaining { 0 };
+        BatchCallback callback;
+    };
+
+    struct Work {
+        std::shared_ptr<Batch> batch;
+        int index;
+    };
+
+    void run();
+
+    std::vector<std::thread> workers;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable ready_wake;
+    std::deque<Work> queue;
+    std::deque<std::shared_ptr<Batch>> ready;
+    bool quit = false;
+
+    int batches_total = 0;
+    int batches_done = 0; // only touched by the GL thread
+    int images_total = 0;
+    std::atomic<int> images_done { 0 };
+};
@@ -85,6 +85,9 @@ int main()
         EndDrawing();
     }
 
+    game.map.chunk_cache.clear();
+    assets.unload_all();
+    texture_atlas.unload();
     UnloadRenderTexture(game.gameView);
     rlImGuiShutdown();
     CloseWindow();
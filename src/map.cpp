@@ -1,8 +1,13 @@
 #include "map.h"
+#include "asset_pack.h"
 #include "editor.h"
+#include "image_cache.h"
+#include "map_format.h"
+#include "prefab.h"
 #include "raylib.h"
 #include "tile.h"
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
@@ -13,176 +18,325 @@
 #include <unordered_map>
 #include <unordered_set>
 
+static int64_t write_time(const std::string& path)
+{
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(path, ec);
+    return ec ? 0 : (int64_t)time.time_since_epoch().count();
+}
+
+// Cooked "@<id>" references and paths into another checkout's resources/ folder, to a name that loads here
+static std::string resolve_texture_name(const std::string& name)
+{
+    if (asset_pack.is_open()) {
+        std::string resolved = asset_pack.resolve(name);
+        const PakEntry* entry = asset_pack.find(resolved);
+        return entry ? asset_pack.name(*entry) : resolved;
+    }
+
+    std::error_code ec;
+    if (std::filesystem::exists(name, ec))
+        return name;
+    std::string local = RESOURCES_PATH + resource_name(name);
+    if (!resource_name(name).empty() && std::filesystem::exists(local, ec))
+        return local;
+    return name;
+}
+
 Map::Map()
 {
 }
 
+Map::~Map()
+{
+    for (TextureHandle& handle : textures)
+        assets.release(handle);
+}
+
 void Map::init()
 {
     load_tilemaps(RESOURCES_PATH "tilemaps/");
+    resize(WORLD_WIDTH, WORLD_HEIGHT);
+    saved_version = layers.version();
+    saved_layers = layers.snapshot();
+}
 
-    for (int i = 0; i < WORLD_WIDTH; i++) {
-        for (int j = 0; j < WORLD_HEIGHT; j++) {
-            // world[i][j] = { i, j, static_cast<eTileType>(rand() % 5) };
-            // dungeon[i][j] = { i, j, eTileType::CHECK };
-            editor_map[i][j] = { i, j, -1, 0 };
-        }
-    }
+void Map::resize(int w, int h)
+{
+    layers.resize(w, h);
+    journal.record_resize(layers.width(), layers.height());
 }
 
 void Map::load_tilemaps(const std::string& folder_path)
 {
+    if (asset_pack.is_open()) {
+        for (const PakEntry* entry : asset_pack.list(PAK_TEXTURE, resource_name(folder_path))) {
+            if (add_texture(asset_pack.name(*entry)) >= 0)
+                TraceLog(LOG_INFO, "Registered tilemap: %s", asset_pack.name(*entry));
+        }
+        return;
+    }
+
+    // Only registered here, each tileset is decoded the first time something draws it
     for (const auto& entry : std::filesystem::directory_iterator(folder_path)) {
         if (entry.path().extension() == ".png") {
             std::string path = entry.path().string();
-            int idx = add_texture(path);
-            if (idx >= 0) {
-                TraceLog(LOG_INFO, "Loaded tilemap: %s", path.c_str());
-            }
+            if (add_texture(path) >= 0)
+                TraceLog(LOG_INFO, "Registered tilemap: %s", path.c_str());
         }
     }
 }
 
+int Map::texture_index(const std::string& path) const
+{
+    auto it = textureLookup.find(path);
+    return it != textureLookup.end() ? it->second : -1;
+}
+
 int Map::add_texture(const std::string& path)
 {
     // Check if already loaded
-    auto it = std::find(textureNames.begin(), textureNames.end(), path);
-    if (it != textureNames.end()) {
-        return std::distance(textureNames.begin(), it);
-    }
+    int index = texture_index(path);
+    if (index >= 0)
+        return index;
 
-    // Load the texture
-    Image img = LoadImage(path.c_str());
-    if (img.data == nullptr) {
-        TraceLog(LOG_ERROR, "Failed to load texture: %s", path.c_str());
+    // Shared with anything else that uses the same file, loaded lazily
+    TextureHandle handle = assets.load_texture(path);
+    if (!handle.valid())
         return -1;
-    }
 
-    Texture2D tex = LoadTextureFromImage(img);
-    UnloadImage(img);
-
-    if (textures.size() >= MAX_TEXTURES) {
-        TraceLog(LOG_WARNING, "No empty slot for new texture");
-        UnloadTexture(tex);
-        return -1;
-    }
-
-    textures.push_back(tex);
+    textureLookup[path] = (int)textures.size();
+    textures.push_back(handle);
     textureNames.push_back(path);
     return textures.size() - 1; // return the index
 }
 
-Texture2D* Map::get_texture_by_name(const std::string& name)
+const AtlasSprite* Map::get_texture_by_name(const std::string& name) const
 {
     for (size_t i = 0; i < textureNames.size(); ++i) {
         if (textureNames[i].find(name) != std::string::npos) // partial match is fine
-            return &textures[i];
+            return &texture((int)i);
     }
     TraceLog(LOG_WARNING, "Texture not found by name: %s", name.c_str());
     return nullptr;
 }
 
-Tile& Map::getTile(int x, int y, eZone zone)
+TileRect Map::visible_tiles(const Camera2D& cam, float view_w, float view_h) const
 {
-    if (zone == eZone::WORLD)
-        return world[x][y];
+    // Check all four corners so a rotated camera is still covered
+    Vector2 corners[4] = {
+        GetScreenToWorld2D({ 0, 0 }, cam),
+        GetScreenToWorld2D({ view_w, 0 }, cam),
+        GetScreenToWorld2D({ 0, view_h }, cam),
+        GetScreenToWorld2D({ view_w, view_h }, cam)
+    };
+
+    float minX = corners[0].x, maxX = corners[0].x;
+    float minY = corners[0].y, maxY = corners[0].y;
+    for (const Vector2& c : corners) {
+        minX = std::min(minX, c.x);
+        maxX = std::max(maxX, c.x);
+        minY = std::min(minY, c.y);
+        maxY = std::max(maxY, c.y);
+    }
 
-    return dungeon[x][y];
+    TileRect area = {
+        (int)std::floor(minX / TILE_WIDTH),
+        (int)std::floor(minY / TILE_HEIGHT),
+        (int)std::floor(maxX / TILE_WIDTH) + 1,
+        (int)std::floor(maxY / TILE_HEIGHT) + 1
+    };
+    return layers[LAYER_GROUND].clamp(area);
 }
 
-void Map::draw()
+void Map::batch_tiles(const TileGrid& grid, const TileRect& area, Vector2 offset, std::vector<TextureHandle>* used)
 {
-    for (int x = 0; x < WORLD_WIDTH; ++x) {
-        for (int y = 0; y < WORLD_HEIGHT; ++y) {
-            Tile& t = editor_map[x][y];
-            if (t.type < 0 || t.textureIndex < 0 || t.textureIndex >= textures.size())
-                continue;
+    grid.for_each_in(area, [&](int x, int y, const Tile& t) {
+        const TileKind& kind = tile_table[t.id];
+        if (kind.textureIndex < 0 || (size_t)kind.textureIndex >= textures.size())
+            return;
+
+        const AtlasSprite& tex = texture(kind.textureIndex); // Use correct texture
+        if (!tex.valid())
+            return;
+        int tilesX = tex.width() / TILE_WIDTH; // Tiles per row
+
+        int texX = kind.type % tilesX;
+        int texY = kind.type / tilesX;
+
+        // Tilesets sharing an atlas page share a bucket
+        Rectangle source = tex.source({ (float)(texX * TILE_WIDTH), (float)(texY * TILE_HEIGHT), (float)TILE_WIDTH, (float)TILE_HEIGHT });
+        Rectangle dest = { x * TILE_WIDTH - offset.x, y * TILE_HEIGHT - offset.y, (float)TILE_WIDTH, (float)TILE_HEIGHT };
+        tile_batch.add(tex.page, tex.texture, source, dest);
+
+        if (used && std::find(used->begin(), used->end(), textures[kind.textureIndex]) == used->end())
+            used->push_back(textures[kind.textureIndex]);
+    });
+}
 
-            Texture2D& tex = textures[t.textureIndex]; // Use correct texture
-            int tilesX = tex.width / TILE_WIDTH; // Tiles per row
+void Map::bake_chunks(const TileRect& area)
+{
+    chunk_cache.new_frame();
+
+    // Chunks baked while a tileset was still a placeholder
+    if (assets.residency_epoch() != baked_epoch) {
+        chunk_cache.invalidate_all();
+        baked_epoch = assets.residency_epoch();
+    }
 
-            int texX = t.type % tilesX;
-            int texY = t.type / tilesX;
+    // Forget chunks that were erased since the last bake
+    chunk_cache.drop_if([&](uint64_t key) {
+        uint64_t chunkKey = key / LAYER_COUNT;
+        return layers[(int)(key % LAYER_COUNT)].find_chunk(TileGrid::key_cx(chunkKey), TileGrid::key_cy(chunkKey)) == nullptr;
+    });
+
+    if (area.empty())
+        return;
 
-            draw_tile(x * TILE_WIDTH, y * TILE_HEIGHT, texX, texY, tex);
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        // Collision is only ever drawn as an overlay, never baked
+        const TileGrid& grid = layers[layer];
+        if (layer == LAYER_COLLISION || grid.chunk_count() == 0)
+            continue;
+
+        for (int cy = area.y0 / CHUNK_SIZE; cy <= (area.y1 - 1) / CHUNK_SIZE; ++cy) {
+            for (int cx = area.x0 / CHUNK_SIZE; cx <= (area.x1 - 1) / CHUNK_SIZE; ++cx) {
+                const TileChunk* chunk = grid.find_chunk(cx, cy);
+                uint64_t key = cache_key(cx, cy, layer);
+                if (!chunk || chunk_cache.is_clean(key, chunk->revision))
+                    continue;
+
+                RenderTexture2D* target = chunk_cache.begin_bake(key);
+                if (!target)
+                    return; // budget spent, the rest is drawn tile by tile this frame
+
+                TileRect chunkArea = { cx * CHUNK_SIZE, cy * CHUNK_SIZE, (cx + 1) * CHUNK_SIZE, (cy + 1) * CHUNK_SIZE };
+                BeginTextureMode(*target);
+                ClearBackground(BLANK);
+                baked_textures.clear();
+                batch_tiles(grid, chunkArea, { (float)(chunkArea.x0 * TILE_WIDTH), (float)(chunkArea.y0 * TILE_HEIGHT) }, &baked_textures);
+                tile_batch.flush();
+                EndTextureMode();
+
+                chunk_cache.end_bake(key, chunk->revision, baked_textures);
+            }
         }
     }
 }
 
+void Map::draw(const TileRect& area, int layer)
+{
+    const TileGrid& grid = layers[layer];
+    if (area.empty() || grid.chunk_count() == 0)
+        return;
+
+    // Clean chunks are a single quad, dirty ones fall back to the tile batch
+    for (int cy = area.y0 / CHUNK_SIZE; cy <= (area.y1 - 1) / CHUNK_SIZE; ++cy) {
+        for (int cx = area.x0 / CHUNK_SIZE; cx <= (area.x1 - 1) / CHUNK_SIZE; ++cx) {
+            const TileChunk* chunk = grid.find_chunk(cx, cy);
+            if (!chunk)
+                continue;
+
+            TileRect chunkArea = { cx * CHUNK_SIZE, cy * CHUNK_SIZE, (cx + 1) * CHUNK_SIZE, (cy + 1) * CHUNK_SIZE };
+            if (const Texture2D* baked = chunk_cache.lookup(cache_key(cx, cy, layer), chunk->revision)) {
+                // Render textures are stored upside down
+                Rectangle source = { 0, 0, (float)baked->width, -(float)baked->height };
+                Rectangle dest = { (float)(chunkArea.x0 * TILE_WIDTH), (float)(chunkArea.y0 * TILE_HEIGHT), (float)baked->width, (float)baked->height };
+                DrawTexturePro(*baked, source, dest, { 0, 0 }, 0.0f, WHITE);
+                continue;
+            }
+
+            batch_tiles(grid, { std::max(area.x0, chunkArea.x0), std::max(area.y0, chunkArea.y0),
+                            std::min(area.x1, chunkArea.x1), std::min(area.y1, chunkArea.y1) },
+                { 0, 0 });
+        }
+    }
+
+    tile_batch.flush();
+}
+
+void Map::draw_collision(const TileRect& area)
+{
+    layers[LAYER_COLLISION].for_each_in(area, [&](int x, int y, const Tile&) {
+        DrawRectangle(x * TILE_WIDTH, y * TILE_HEIGHT, TILE_WIDTH, TILE_HEIGHT, Fade(RED, 0.35f));
+    });
+
+    // Outlines of the merged rectangles movement is tested against
+    collision.update(layers[LAYER_COLLISION]);
+    std::vector<Rectangle> merged;
+    collision.query({ (float)(area.x0 * TILE_WIDTH), (float)(area.y0 * TILE_HEIGHT), (float)((area.x1 - area.x0) * TILE_WIDTH), (float)((area.y1 - area.y0) * TILE_HEIGHT) }, merged);
+    for (const Rectangle& r : merged)
+        DrawRectangleLinesEx(r, 1.0f, MAROON);
+}
+
 void Map::draw_tile(int pos_x, int pos_y, int texture_index_x, int texture_index_y)
 {
-    Rectangle source = { (float)TILE_WIDTH * texture_index_x, (float)TILE_HEIGHT * texture_index_y, (float)TILE_WIDTH, (float)TILE_HEIGHT };
-    Rectangle dest = { (float)pos_x, (float)pos_y, (float)TILE_WIDTH, (float)(TILE_HEIGHT) };
-    Vector2 origin = { 0, 0 };
-    DrawTexturePro(textures[TEXTURE_TILEMAP], source, dest, origin, 0.0f, WHITE);
+    draw_tile(pos_x, pos_y, texture_index_x, texture_index_y, texture(TEXTURE_TILEMAP));
 }
 
 void Map::draw_tile(int pos_x, int pos_y, int tex_x, int tex_y, const std::string& textureName)
 {
-    Texture2D* tex = get_texture_by_name(textureName);
+    const AtlasSprite* tex = get_texture_by_name(textureName);
     if (!tex)
         return;
 
-    Rectangle source = {
-        (float)(tex_x * TILE_WIDTH),
-        (float)(tex_y * TILE_HEIGHT),
-        (float)TILE_WIDTH,
-        (float)TILE_HEIGHT
-    };
-    Rectangle dest = { (float)pos_x, (float)pos_y, (float)TILE_WIDTH, (float)TILE_HEIGHT };
-    Vector2 origin = { 0, 0 };
-
-    DrawTexturePro(*tex, source, dest, origin, 0.f, WHITE);
+    draw_tile(pos_x, pos_y, tex_x, tex_y, *tex);
 }
 
-void Map::draw_tile(int pos_x, int pos_y, int tile_index_x, int tile_index_y, Texture2D& tex)
+void Map::draw_tile(int pos_x, int pos_y, int tile_index_x, int tile_index_y, const AtlasSprite& tex)
 {
-    Rectangle source = {
+    Rectangle source = tex.source({
         (float)(tile_index_x * TILE_WIDTH),
         (float)(tile_index_y * TILE_HEIGHT),
         (float)TILE_WIDTH,
-        (float)TILE_HEIGHT
-    };
+        (float)TILE_HEIGHT });
     Rectangle dest = { (float)pos_x, (float)pos_y, (float)TILE_WIDTH, (float)TILE_HEIGHT };
     Vector2 origin = { 0, 0 };
-    DrawTexturePro(tex, source, dest, origin, 0.f, WHITE);
+    DrawTexturePro(tex.texture, source, dest, origin, 0.f, WHITE);
 }
 
 void Map::draw_grid(int width, int height, int tile_w, int tile_h, float line, Color color = { 255, 255, 255, 255 })
 {
-    for (int x = 0; x <= width; x++) {
+    draw_grid(TileRect { 0, 0, width, height }, tile_w, tile_h, line, color);
+}
+
+void Map::draw_grid(const TileRect& area, int tile_w, int tile_h, float line, Color color = { 255, 255, 255, 255 })
+{
+    // Lines only span the visible range instead of the whole map
+    float top = (float)(area.y0 * tile_h);
+    float bottom = (float)(area.y1 * tile_h);
+    float left = (float)(area.x0 * tile_w);
+    float right = (float)(area.x1 * tile_w);
+
+    for (int x = area.x0; x <= area.x1; x++) {
         int pos_x = x * tile_w;
         // DrawLine(pos_x, 0, pos_x, height * tile_h, color);
-        DrawLineEx(Vector2 { (float)pos_x, 0 }, Vector2 { (float)pos_x, (float)(height * tile_h) }, line, color);
+        DrawLineEx(Vector2 { (float)pos_x, top }, Vector2 { (float)pos_x, bottom }, line, color);
     }
 
-    for (int y = 0; y <= height; y++) {
+    for (int y = area.y0; y <= area.y1; y++) {
         int pos_y = y * tile_h;
         // DrawLine(0, pos_y, width * tile_w, pos_y, color);
-        DrawLineEx(Vector2 { 0, (float)pos_y }, Vector2 { (float)(width * tile_w), (float)pos_y }, line, color);
+        DrawLineEx(Vector2 { left, (float)pos_y }, Vector2 { right, (float)pos_y }, line, color);
     }
 }
 
-void Map::draw_editor_map(const EditorViewport& viewport, Editor& editor, Camera2D& cam)
+void Map::draw_editor_map(const EditorViewport& viewport, Editor& editor, Camera2D& cam, const TileRect& area)
 {
-    DrawRectangle(0, 0, TILE_WIDTH * WORLD_WIDTH, TILE_HEIGHT * WORLD_HEIGHT, DARKGRAY);
-    draw_grid(WORLD_WIDTH, WORLD_HEIGHT, TILE_WIDTH, TILE_HEIGHT, 1.0f, BLACK);
+    DrawRectangle(area.x0 * TILE_WIDTH, area.y0 * TILE_HEIGHT,
+        (area.x1 - area.x0) * TILE_WIDTH, (area.y1 - area.y0) * TILE_HEIGHT, DARKGRAY);
+    draw_grid(area, TILE_WIDTH, TILE_HEIGHT, 1.0f, BLACK);
 
-    // Draw placed tiles from editor_map
-    for (int x = 0; x < WORLD_WIDTH; ++x) {
-        for (int y = 0; y < WORLD_HEIGHT; ++y) {
-            Tile& t = editor_map[x][y];
-            if (t.type < 0 || t.textureIndex < 0 || t.textureIndex >= textures.size())
-                continue;
-
-            // Use the correct texture for this tile
-            Texture2D& tex = textures[t.textureIndex]; // assumes Tile stores textureIndex
-            int tilesX = tex.width / TILE_WIDTH; // tiles per row in this texture
-            int texX = t.type % tilesX;
-            int texY = t.type / tilesX;
-            draw_tile(x * TILE_WIDTH, y * TILE_HEIGHT, texX, texY, tex);
-        }
+    // Visible layers bottom to top, collision tinted so it reads as an overlay
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        if (!editor.layer_visible[layer])
+            continue;
+        if (layer == LAYER_COLLISION)
+            draw_collision(area);
+        else
+            draw(area, layer);
     }
+    draw_entities(editor, area);
 
     ImVec2 mousePos = ImGui::GetMousePos();
     float mouseX = mousePos.x - viewport.x;
@@ -198,9 +352,14 @@ void Map::draw_editor_map(const EditorViewport& viewport, Editor& editor, Camera
     int tileX = (int)(mouseWorld.x / TILE_WIDTH);
     int tileY = (int)(mouseWorld.y / TILE_HEIGHT);
 
+    if (editor.entity_mode) {
+        edit_entities(editor, tileX, tileY);
+        return;
+    }
+
     // if (tileX >= 0 && tileY >= 0 && tileX < WORLD_WIDTH && tileY < WORLD_HEIGHT) {
     int selIndex = editor.selected_index_y * editor.tiles_x + editor.selected_index_x;
-    Texture2D& selTex = textures[editor.selectedTextureIndex];
+    const AtlasSprite& selTex = texture(editor.selectedTextureIndex);
     int selX = editor.selected_index_x;
     int selY = editor.selected_index_y;
 
@@ -209,209 +368,278 @@ void Map::draw_editor_map(const EditorViewport& viewport, Editor& editor, Camera
     else if (editor.cancel_tile_mode)
         DrawRectangle(tileX * TILE_WIDTH, tileY * TILE_HEIGHT, TILE_WIDTH, TILE_HEIGHT, Fade(RED, 0.4f));
 
-    if (tileX >= 0 && tileY >= 0 && tileX < WORLD_WIDTH && tileY < WORLD_HEIGHT) {
+    // Hidden and locked layers can't be painted
+    int layer = editor.active_layer;
+    if (!editor.layer_visible[layer] || editor.layer_locked[layer])
+        return;
+    TileGrid& grid = layers[layer];
+
+    if (grid.in_bounds(tileX, tileY)) {
         if (editor.cancel_tile_mode && IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
-            editor_map[tileX][tileY].type = -1; // remove tile type
-            editor_map[tileX][tileY].textureIndex = -1; // remove texture
+            // remove tile type and texture
+            if (grid.set(tileX, tileY, -1, -1))
+                journal.record_set(layer, tileX, tileY, -1, -1, textureNames);
         } else if (IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
-            editor_map[tileX][tileY].type = editor.selected_index_y * editor.tiles_x + editor.selected_index_x;
-            editor_map[tileX][tileY].textureIndex = editor.selectedTextureIndex;
+            if (grid.set(tileX, tileY, selIndex, editor.selectedTextureIndex))
+                journal.record_set(layer, tileX, tileY, selIndex, editor.selectedTextureIndex, textureNames);
         }
 
         if (editor.fill_all_mode) {
 
             // DrawRectangle(0, 0, TILE_WIDTH * WORLD_WIDTH, TILE_HEIGHT * WORLD_HEIGHT, Fade(GREEN, 0.4f));
-            for (int x = 0; x < WORLD_WIDTH; ++x) {
-                for (int y = 0; y < WORLD_HEIGHT; ++y) {
+            for (int x = area.x0; x < area.x1; ++x) {
+                for (int y = area.y0; y < area.y1; ++y) {
                     draw_tile(x * TILE_WIDTH, y * TILE_HEIGHT, selX, selY, selTex);
                     DrawRectangle(x * TILE_WIDTH, y * TILE_HEIGHT, TILE_WIDTH, TILE_HEIGHT, Fade(GREEN, 0.3f));
                 }
             }
 
-            if (IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
-                for (int x = 0; x < WORLD_WIDTH; ++x) {
-                    for (int y = 0; y < WORLD_HEIGHT; ++y) {
-                        editor_map[x][y].type = editor.selected_index_y * editor.tiles_x + editor.selected_index_x;
-                        editor_map[x][y].textureIndex = editor.selectedTextureIndex;
-                    }
-                }
-            }
+            // Once per click, holding the button doesn't refill (and rebake) the layer every frame
+            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && grid.fill(selIndex, editor.selectedTextureIndex))
+                journal.record_fill(layer, selIndex, editor.selectedTextureIndex, textureNames);
         }
     }
     //}
 }
 
-/*
-map.bin:
-    [int] textureCount
-    For each texture:
-        [int] nameLength
-        [char * nameLength] textureName (relative filename like "dungeon_floor.png")
-
-    For each tile:
-        [int] type
-        [int] textureIndex
-*/
+static Rectangle prefab_rect(const Prefab& prefab, int tileX, int tileY)
+{
+    float size = TILE_WIDTH * std::get<Position>(prefab.values).scale;
+    return { (float)(tileX * TILE_WIDTH), (float)(tileY * TILE_HEIGHT), size, size };
+}
 
-/*bool Map::save_to_file(const std::string& path)
+void Map::draw_entities(const Editor& editor, const TileRect& area)
 {
-    std::ofstream file(path, std::ios::binary);
-    if (!file.is_open()) {
-        TraceLog(LOG_ERROR, "Failed to open file for writing: %s", path.c_str());
-        return false;
-    }
+    if (!editor.prefabs)
+        return;
+    const PrefabLibrary& library = *editor.prefabs;
+
+    std::vector<int> resolved(entities.prefabs.size());
+    for (size_t i = 0; i < entities.prefabs.size(); ++i)
+        resolved[i] = library.find(entities.prefabs[i]);
 
-    for (int y = 0; y < WORLD_HEIGHT; ++y) {
-        for (int x = 0; x < WORLD_WIDTH; ++x) {
-            Tile& t = editor_map[x][y];
-            file.write(reinterpret_cast<char*>(&t.type), sizeof(int));
-            file.write(reinterpret_cast<char*>(&t.textureIndex), sizeof(int));
+    for (const MapFileEntity& placed : entities.placed) {
+        if (placed.x < area.x0 || placed.x >= area.x1 || placed.y < area.y0 || placed.y >= area.y1)
+            continue;
+        int prefab = resolved[placed.prefab];
+        if (prefab < 0) {
+            // Unknown prefab, the game skips it
+            DrawRectangleLines(placed.x * TILE_WIDTH, placed.y * TILE_HEIGHT, TILE_WIDTH, TILE_HEIGHT, RED);
+            continue;
         }
+        library.draw_icon(prefab, prefab_rect(library[prefab], placed.x, placed.y), WHITE);
     }
-    file.close();
-    return true;
-}*/
-bool Map::save_to_file(const std::string& path)
+}
+
+void Map::edit_entities(Editor& editor, int tileX, int tileY)
 {
-    std::ofstream file(path, std::ios::binary);
-    if (!file.is_open())
-        return false;
+    if (!layers.in_bounds(tileX, tileY) || !editor.prefabs || editor.prefabs->size() == 0)
+        return;
 
-    // Write only textures actually used in the map
-    std::unordered_set<int> usedTextures;
-    for (int y = 0; y < WORLD_HEIGHT; ++y)
-        for (int x = 0; x < WORLD_WIDTH; ++x)
-            if (editor_map[x][y].textureIndex >= 0)
-                usedTextures.insert(editor_map[x][y].textureIndex);
-
-    std::vector<std::string> texList;
-    std::unordered_map<int, int> indexMap;
-    int idx = 0;
-    for (int texIdx : usedTextures) {
-        texList.push_back(textureNames[texIdx]);
-        indexMap[texIdx] = idx++;
+    if (editor.cancel_tile_mode) {
+        DrawRectangle(tileX * TILE_WIDTH, tileY * TILE_HEIGHT, TILE_WIDTH, TILE_HEIGHT, Fade(RED, 0.4f));
+        if (IsMouseButtonDown(MOUSE_LEFT_BUTTON))
+            entities.erase_at(tileX, tileY);
+        return;
     }
 
-    // Write texture list
-    int tex_count = texList.size();
-    file.write(reinterpret_cast<char*>(&tex_count), sizeof(int));
-    for (const std::string& name : texList) {
-        int len = (int)name.size();
-        file.write(reinterpret_cast<char*>(&len), sizeof(int));
-        file.write(name.c_str(), len);
-    }
+    const PrefabLibrary& library = *editor.prefabs;
+    int prefab = std::clamp(editor.selected_prefab, 0, (int)library.size() - 1);
+    library.draw_icon(prefab, prefab_rect(library[prefab], tileX, tileY), Fade(WHITE, 0.6f));
+    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && !entities.place(library[prefab].name, tileX, tileY, (eZone)editor.placement_zone))
+        TraceLog(LOG_WARNING, "Can't place prefab %s at %d,%d", library[prefab].name.c_str(), tileX, tileY);
+}
 
-    // Write map tiles with remapped texture indexes
-    for (int y = 0; y < WORLD_HEIGHT; ++y) {
-        for (int x = 0; x < WORLD_WIDTH; ++x) {
-            Tile& t = editor_map[x][y];
-            file.write(reinterpret_cast<char*>(&t.type), sizeof(int));
+// File layouts are documented in map_format.h
 
-            int mappedIndex = (t.textureIndex >= 0) ? indexMap[t.textureIndex] : -1;
-            file.write(reinterpret_cast<char*>(&mappedIndex), sizeof(int));
-        }
+bool Map::save_to_file(const std::string& path)
+{
+    std::vector<uint8_t> bytes = encode_map_file(layers, textureNames, entities);
+    if (!write_map_file(path, bytes)) {
+        TraceLog(LOG_ERROR, "Failed to write map: %s", path.c_str());
+        return false;
     }
 
-    file.close();
     TraceLog(LOG_INFO, "Map saved successfully: %s", path.c_str());
+    saved_version = layers.version();
+    saved_layers = layers.snapshot();
+    saved_entity_version = entities.version;
     return true;
 }
 
-/*bool Map::load_from_file(const std::string& path)
+void Map::save_async(const std::string& path, eSaveKind kind)
 {
-    std::ifstream file(path, std::ios::binary);
-    if (!file.is_open()) {
-        TraceLog(LOG_ERROR, "Failed to open file for writing: %s", path.c_str());
-        return false;
+    if (kind != eSaveKind::Manual) {
+        saver.save(path, layers.snapshot(), textureNames, entities, kind);
+        return;
     }
 
-    for (int y = 0; y < WORLD_HEIGHT; ++y) {
-        for (int x = 0; x < WORLD_WIDTH; ++x) {
-            Tile& t = editor_map[x][y];
-            if (!file.read(reinterpret_cast<char*>(&t.type), sizeof(int)))
-                break; // in case old map version
+    // Edits after the snapshot must land in a journal the new file doesn't cover yet
+    journal.begin_compaction(path);
+    saving_layers = layers.snapshot();
+    saver.save(path, saving_layers.snapshot(), textureNames, entities, kind);
+}
 
-            if (!file.read(reinterpret_cast<char*>(&t.textureIndex), sizeof(int))) {
-                t.textureIndex = 0; // backward compatibility: default to first texture
+void Map::compact()
+{
+    // The file may only ever hold what the user saved
+    if (!journal.is_open() || entities.version != saved_entity_version)
+        return;
+
+    std::string path = journal.map_path();
+    if (!journal.begin_compaction(path))
+        return; // the old journal stays and is replayed on top of the old file
+    journal_unsaved_edits();
+    if (!journal.carry_over()) {
+        // Without them on disk the old journal has to stay, retry once the journal grows again
+        TraceLog(LOG_ERROR, "Can't carry unsaved edits over to the journal of %s", path.c_str());
+        return;
+    }
+    saver.save(path, saved_layers.snapshot(), textureNames, entities, eSaveKind::Compact);
+}
+
+void Map::journal_unsaved_edits()
+{
+    if (saved_layers.width() != layers.width() || saved_layers.height() != layers.height())
+        journal.record_resize(layers.width(), layers.height());
+
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        const TileGrid& saved = saved_layers[layer];
+        const TileGrid& live = layers[layer];
+
+        // Chunks the snapshot still shares weren't edited since the save
+        std::vector<uint64_t> changed;
+        live.for_each_chunk([&](int cx, int cy, const TileChunk& chunk) {
+            if (saved.find_chunk(cx, cy) != &chunk)
+                changed.push_back(TileGrid::chunk_key(cx, cy));
+        });
+        saved.for_each_chunk([&](int cx, int cy, const TileChunk&) {
+            if (!live.find_chunk(cx, cy))
+                changed.push_back(TileGrid::chunk_key(cx, cy));
+        });
+
+        for (uint64_t key : changed) {
+            int baseX = TileGrid::key_cx(key) * CHUNK_SIZE;
+            int baseY = TileGrid::key_cy(key) * CHUNK_SIZE;
+            int endX = std::min(baseX + CHUNK_SIZE, live.width());
+            int endY = std::min(baseY + CHUNK_SIZE, live.height());
+            for (int y = baseY; y < endY; ++y) {
+                for (int x = baseX; x < endX; ++x) {
+                    const Tile& now = live.get(x, y);
+                    if (now.id != saved.get(x, y).id)
+                        journal.record_set(layer, x, y, now.type(), now.textureIndex(), textureNames);
+                }
             }
         }
     }
+}
+
+bool Map::save_journal(const std::string& path)
+{
+    if (!journal.is_open() || journal.map_path() != path || !std::filesystem::exists(path))
+        return false;
+    // The journal only has tile edits
+    if (entities.version != saved_entity_version)
+        return false;
+    if (!journal.sync())
+        return false;
 
-    file.close();
+    saved_version = layers.version();
+    saved_layers = layers.snapshot();
     return true;
-}*/
-bool Map::load_from_file(const std::string& path)
+}
+
+bool Map::poll_save(MapSaver::Result& result)
 {
-    std::ifstream file(path, std::ios::binary);
-    if (!file.is_open())
+    if (!saver.poll_result(result))
         return false;
 
-    // Read required texture list
-    int tex_count = 0;
-    file.read(reinterpret_cast<char*>(&tex_count), sizeof(int));
-    std::vector<std::string> required_textures(tex_count);
-
-    for (int i = 0; i < tex_count; ++i) {
-        int len = 0;
-        file.read(reinterpret_cast<char*>(&len), sizeof(int));
-        std::string tex_name(len, '\0');
-        file.read(&tex_name[0], len);
-        required_textures[i] = tex_name;
-    }
+    if (result.kind != eSaveKind::Autosave)
+        journal.end_compaction(result.path, result.ok);
+    if (result.kind == eSaveKind::Manual && result.ok && result.version == saving_layers.version())
+        saved_layers = std::move(saving_layers);
+    if (result.ok)
+        write_times[result.path] = write_time(result.path); // our own write, not an outside change
+    return true;
+}
 
-    // Track old textureNames to remap tile indexes
-    std::vector<std::string> oldTextures = textureNames;
+bool Map::changed_on_disk(const std::string& path) const
+{
+    auto it = write_times.find(path);
+    return it == write_times.end() || it->second != write_time(path);
+}
 
-    // Merge textures
-    for (const std::string& texName : required_textures) {
-        add_texture(texName); // add if not present
-    }
+bool Map::reload_from_disk(const std::string& path)
+{
+    if (journal.map_path() == path)
+        journal.close();
+    MapJournal::discard(path);
+    return load_from_file(path);
+}
 
-    // Build a map from old index -> new index
-    std::unordered_map<int, int> indexMap;
-    for (int i = 0; i < oldTextures.size(); ++i) {
-        auto it = std::find(textureNames.begin(), textureNames.end(), oldTextures[i]);
-        if (it != textureNames.end()) {
-            indexMap[i] = std::distance(textureNames.begin(), it);
+bool Map::load_from_file(const std::string& path)
+{
+    // Cooked maps are read straight out of the pack and aren't journaled
+    MapFileContents contents;
+    const PakEntry* cooked = asset_pack.find(path);
+    if (cooked && cooked->kind != PAK_MAP)
+        cooked = nullptr;
+    if (cooked) {
+        if (!decode_map_file(asset_pack.data(*cooked), cooked->size, contents)) {
+            TraceLog(LOG_ERROR, "Corrupt cooked map: %s", path.c_str());
+            return false;
         }
+    } else {
+        if (!read_map_file(path, contents))
+            return false;
+        write_times[path] = write_time(path);
     }
 
     // Verify missing textures
     missingTextures.clear();
-    for (const std::string& texName : required_textures) {
-        if (!std::filesystem::exists(texName)) {
+    for (std::string& texName : contents.textures) {
+        texName = resolve_texture_name(texName);
+        if (!asset_pack.find(texName) && !std::filesystem::exists(texName)) {
             missingTextures.push_back(texName);
         }
     }
 
     if (!missingTextures.empty()) {
         showMissingTexturesModal = true;
-        file.close();
         return false;
     }
 
-    // Load map tile data
-    for (int y = 0; y < WORLD_HEIGHT; ++y) {
-        for (int x = 0; x < WORLD_WIDTH; ++x) {
-            Tile& t = editor_map[x][y];
-            if (!file.read(reinterpret_cast<char*>(&t.type), sizeof(int)))
-                break;
-            int savedTextureIndex;
-            if (!file.read(reinterpret_cast<char*>(&savedTextureIndex), sizeof(int)))
-                break;
-
-            // Remap to current texture index
-            if (savedTextureIndex >= 0 && savedTextureIndex < required_textures.size()) {
-                t.textureIndex = std::distance(textureNames.begin(),
-                    std::find(textureNames.begin(), textureNames.end(), required_textures[savedTextureIndex]));
-            } else {
-                t.textureIndex = -1; // invalid
-            }
-        }
+    // Merge textures, building file index -> runtime index once instead of per tile
+    std::vector<int> textureRemap(contents.textures.size(), -1);
+    for (size_t i = 0; i < contents.textures.size(); ++i)
+        textureRemap[i] = add_texture(contents.textures[i]); // add if not present
+
+    contents.resolve_tiles(textureRemap);
+
+    layers = std::move(contents.layers);
+    saved_version = layers.version();
+    saved_layers = layers.snapshot();
+    // Still counting up, so the game sees a new set of entities even when both maps have none
+    contents.entities.version = entities.version + 1;
+    entities = std::move(contents.entities);
+    saved_entity_version = entities.version;
+    // Before the journal replays, so only the chunks it edits get merged again
+    if (contents.has_collision)
+        collision.adopt(layers[LAYER_COLLISION], contents.collision);
+
+    // Edits that never made it into the map file, those after the last Save stay unsaved
+    journal.close();
+    if (!cooked) {
+        MapJournal::ReplayStats replayed = MapJournal::replay(path, layers, [this](const std::string& name) { return add_texture(resolve_texture_name(name)); });
+        saved_version = replayed.saved_version;
+        saved_layers = std::move(replayed.saved);
+        if (replayed.records > 0)
+            TraceLog(LOG_INFO, "Replayed %d journaled edits (%d unsaved)", replayed.records, replayed.unsaved);
+        journal.open(path);
     }
 
-    file.close();
-    TraceLog(LOG_INFO, "Map loaded successfully: %s", path.c_str());
+    TraceLog(LOG_INFO, "Map loaded successfully: %s (v%d, %dx%d, %d chunks)",
+        path.c_str(), contents.version, layers.width(), layers.height(), (int)layers.chunk_count());
     return true;
 }
 
@@ -434,12 +662,12 @@ void Map::draw_tilemap_previews(Editor& editor)
     float xOffset = 0.0f; // track horizontal cursor
                           //
     for (int i = 0; i < textures.size(); ++i) {
-        Texture2D& tex = textures[i];
-        if (!tex.id)
+        const AtlasSprite& tex = texture(i);
+        if (!tex.valid())
             continue;
 
         // Maintain aspect ratio
-        float aspect = (float)tex.width / (float)tex.height;
+        float aspect = tex.rect.width / tex.rect.height;
         float previewW, previewH;
         if (aspect >= 1.0f) {
             previewW = maxPreviewSize;
@@ -507,7 +735,9 @@ void Map::draw_tilemap_previews(Editor& editor)
         drawList->AddText(textPos, IM_COL32(255, 255, 255, 255), displayName.c_str());
         // Draw texture centered
         ImVec2 imgPos(cardPos.x + (cardW - previewW) * 0.5f, cardPos.y + 24.0f);
-        drawList->AddImage((ImTextureID)(intptr_t)tex.id, imgPos, ImVec2(imgPos.x + previewW, imgPos.y + previewH));
+        ImVec2 uv0(tex.rect.x / tex.texture.width, tex.rect.y / tex.texture.height);
+        ImVec2 uv1((tex.rect.x + tex.rect.width) / tex.texture.width, (tex.rect.y + tex.rect.height) / tex.texture.height);
+        drawList->AddImage((ImTextureID)(intptr_t)tex.texture.id, imgPos, ImVec2(imgPos.x + previewW, imgPos.y + previewH), uv0, uv1);
 
         ImGui::Dummy(ImVec2(cardW, 10)); // Advance cursor
         ImGui::EndGroup();
@@ -1,10 +1,19 @@
 #ifndef MAP_H
 #define MAP_H
 
+#include "asset_manager.h"
+#include "chunk_cache.h"
+#include "collision_grid.h"
 #include "editor.h"
+#include "map_journal.h"
+#include "map_saver.h"
+#include "texture_atlas.h"
 #include "tile.h"
+#include "tile_batch.h"
+#include "tile_grid.h"
 #include <raylib.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 struct EditorViewport {
@@ -16,36 +25,95 @@ class Map {
 
 public:
     Map();
+    ~Map();
     void init();
     // void draw(eZone zone);
-    void draw();
-    Tile& getTile(int x, int y, eZone zone);
+    void draw(const TileRect& area, int layer);
+    // Collision cells as a translucent overlay, whatever tile was painted there, and the rectangles they merge into
+    void draw_collision(const TileRect& area);
+    // Rebakes dirty cached chunks of every layer inside area, call outside of any texture mode
+    void bake_chunks(const TileRect& area);
+    int width() const { return layers.width(); }
+    int height() const { return layers.height(); }
+    void resize(int w, int h);
 
-    Texture2D* get_texture_by_name(const std::string& name);
+    const AtlasSprite* get_texture_by_name(const std::string& name) const;
     void draw_tile(int pos_x, int pos_y, int texture_index_x, int texture_index_y);
-    void draw_tile(int pos_x, int pos_y, int texture_index_x, int texture_index_y, Texture2D& tex);
+    void draw_tile(int pos_x, int pos_y, int texture_index_x, int texture_index_y, const AtlasSprite& tex);
     void draw_tile(int pos_x, int pos_y, int tex_x, int tex_y, const std::string& textureName);
 
+    // Tiles covered by a camera rendering into a view of the given size, clamped to the map
+    TileRect visible_tiles(const Camera2D& cam, float view_w, float view_h) const;
+
     void draw_grid(int w, int h, int tile_w, int tile_h, float line, Color color);
+    void draw_grid(const TileRect& area, int tile_w, int tile_h, float line, Color color);
     void draw_tilemap_previews(Editor& editor);
-    void draw_editor_map(const EditorViewport& viewport, Editor& editor, Camera2D& cam);
+    void draw_editor_map(const EditorViewport& viewport, Editor& editor, Camera2D& cam, const TileRect& area);
+    // Placed entities inside area, as their prefab's icon
+    void draw_entities(const Editor& editor, const TileRect& area);
+    // Entity mode: places the editor's prefab on the clicked tile, or erases in cancel mode
+    void edit_entities(Editor& editor, int tileX, int tileY);
 
-    Tile editor_map[WORLD_WIDTH][WORLD_HEIGHT];
+    TileLayers layers;
+    // Compiled from layers[LAYER_COLLISION] by Game::update, only edited chunks are merged again
+    CollisionGrid collision;
+    TileBatch tile_batch;
+    ChunkCache chunk_cache;
     // Texture2D textures[MAX_TEXTURES];
     // int textureCount = 0;
-    std::vector<Texture2D> textures;
+    // Tilesets indexed by Tile::textureIndex, the map holds a reference to each
+    std::vector<TextureHandle> textures;
     std::vector<std::string> textureNames;
+    const AtlasSprite& texture(int index) const { return assets.sprite(textures[index]); }
+    // -1 when the tileset hasn't been added
+    int texture_index(const std::string& path) const;
     std::vector<std::string> missingTextures;
     bool showMissingTexturesModal = false;
 
     int add_texture(const std::string& path);
+    // Registers every tileset of the folder, they are loaded on first use
     void load_tilemaps(const std::string& folder_path);
     bool save_to_file(const std::string& path);
+    // Snapshots the layers and hands them to saver, returns immediately.
+    // Manual saves restart the journal of path.
+    void save_async(const std::string& path, eSaveKind kind = eSaveKind::Manual);
+    // Rewrites the journaled map file with saved_layers in the background, the unsaved edits
+    // move to the new journal. Does nothing while entities are unsaved, they aren't journaled.
+    void compact();
+    // Makes the journaled edits durable instead of rewriting the map, false if path isn't journaled
+    bool save_journal(const std::string& path);
+    // Pops a finished background save and retires the journal it replaced
+    bool poll_save(MapSaver::Result& result);
+    // Replays <path>.journal on top of the map file and keeps journaling to it
     bool load_from_file(const std::string& path);
+    bool has_unsaved_changes() const { return layers.version() != saved_version || entities.version != saved_entity_version; }
+    // True when path was written by something else since this map last read or saved it
+    bool changed_on_disk(const std::string& path) const;
+    // Loads path again after an outside change, its journal belonged to the old file and is dropped
+    bool reload_from_disk(const std::string& path);
+
+    MapSaver saver;
+    MapJournal journal;
+    uint64_t saved_version = 0; // layers.version() last written to or read from the map file
+    TileLayers saved_layers; // snapshot of the layers at saved_version, shares the chunks edited since
+
+    // Placed entities. They aren't journaled: saving after changing them rewrites the map file.
+    MapEntities entities;
+    uint64_t saved_entity_version = 0;
 
 private:
-    Tile world[WORLD_WIDTH][WORLD_HEIGHT];
-    Tile dungeon[WORLD_WIDTH][WORLD_HEIGHT];
+    // Records how layers differ from saved_layers, so replaying it over them gives layers back
+    void journal_unsaved_edits();
+    // Appends the handle of each tileset it draws from to used, once
+    void batch_tiles(const TileGrid& grid, const TileRect& area, Vector2 offset, std::vector<TextureHandle>* used = nullptr);
+    // Chunk cache keys carry the layer, so each layer of a chunk is baked separately
+    static uint64_t cache_key(int cx, int cy, int layer) { return TileGrid::chunk_key(cx, cy) * LAYER_COUNT + layer; }
+
+    std::unordered_map<std::string, int> textureLookup; // path -> index into textures
+    uint32_t baked_epoch = 0; // assets.residency_epoch() the chunk cache was baked with
+    std::vector<TextureHandle> baked_textures; // tilesets of the chunk being baked, reused
+    TileLayers saving_layers; // what the newest manual save in flight writes
+    std::unordered_map<std::string, int64_t> write_times; // map file -> mtime when last read or saved here
 };
 
 #endif
@@ -0,0 +1,696 @@
+#include "map_format.h"
+#include "collision_grid.h"
+#include "compress.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <new>
+#include <raylib.h>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Footer appended by the headerless layout once maps got runtime dimensions
+static constexpr int LEGACY_SIZE_TAG = 0x4d494457; // "WDIM"
+
+static size_t align8(size_t n)
+{
+    return (n + 7) & ~(size_t)7;
+}
+
+template <typename T>
+static void put(std::vector<uint8_t>& out, size_t at, const T& value)
+{
+    std::memcpy(out.data() + at, &value, sizeof(T));
+}
+
+template <typename T>
+static bool get(const uint8_t* data, size_t size, size_t at, T& value)
+{
+    if (at > size || size - at < sizeof(T))
+        return false;
+    std::memcpy(&value, data + at, sizeof(T));
+    return true;
+}
+
+static uint32_t tile_bits(const MapFileTile& t)
+{
+    uint32_t v;
+    std::memcpy(&v, &t, sizeof(v));
+    return v;
+}
+
+// Palette + run-length pass, then LZ over the result. Filled or mostly
+// uniform chunks end up a few bytes long.
+static std::vector<uint8_t> pack_chunk(const MapFileTile* tiles, int count)
+{
+    std::vector<uint32_t> palette;
+    std::unordered_map<uint32_t, uint32_t> paletteIndex;
+    std::vector<uint32_t> indices(count);
+    for (int n = 0; n < count; ++n) {
+        uint32_t bits = tile_bits(tiles[n]);
+        auto [it, inserted] = paletteIndex.try_emplace(bits, (uint32_t)palette.size());
+        if (inserted)
+            palette.push_back(bits);
+        indices[n] = it->second;
+    }
+
+    std::vector<uint8_t> stream;
+    put_varint(stream, (uint32_t)palette.size());
+    for (uint32_t bits : palette) {
+        const uint8_t* b = reinterpret_cast<const uint8_t*>(&bits);
+        stream.insert(stream.end(), b, b + sizeof(bits));
+    }
+
+    for (int n = 0; n < count;) {
+        int run = 1;
+        while (n + run < count && indices[n + run] == indices[n])
+            run++;
+        put_varint(stream, (uint32_t)run);
+        put_varint(stream, indices[n]);
+        n += run;
+    }
+
+    std::vector<uint8_t> out;
+    put_varint(out, (uint32_t)stream.size());
+    std::vector<uint8_t> lz = lz_compress(stream.data(), stream.size());
+    out.insert(out.end(), lz.begin(), lz.end());
+    return out;
+}
+
+static bool unpack_chunk(const uint8_t* data, size_t size, MapFileTile* tiles, int count)
+{
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    uint32_t streamSize;
+    // A stream holds at least its palette count
+    if (!get_varint(p, end, streamSize) || streamSize == 0 || streamSize > (uint32_t)count * 16 + 16)
+        return false;
+
+    std::vector<uint8_t> stream(streamSize);
+    if (!lz_decompress(p, end - p, stream.data(), stream.size()))
+        return false;
+
+    p = stream.data();
+    end = p + stream.size();
+
+    uint32_t paletteCount;
+    if (!get_varint(p, end, paletteCount) || (size_t)(end - p) / sizeof(MapFileTile) < paletteCount)
+        return false;
+    const uint8_t* palette = p;
+    p += paletteCount * sizeof(MapFileTile);
+
+    int n = 0;
+    while (n < count) {
+        uint32_t run, index;
+        if (!get_varint(p, end, run) || !get_varint(p, end, index))
+            return false;
+        if (run == 0 || run > (uint32_t)(count - n) || index >= paletteCount)
+            return false;
+
+        MapFileTile t;
+        std::memcpy(&t, palette + index * sizeof(MapFileTile), sizeof(t));
+        for (uint32_t k = 0; k < run; ++k)
+            tiles[n++] = t;
+    }
+    return true;
+}
+
+static size_t strings_size(const std::vector<std::string>& strings)
+{
+    size_t size = sizeof(MapFileString) * strings.size();
+    for (const std::string& s : strings)
+        size += s.size();
+    return size;
+}
+
+static void put_strings(std::vector<uint8_t>& out, size_t at, const std::vector<std::string>& strings)
+{
+    uint32_t blob = (uint32_t)(sizeof(MapFileString) * strings.size());
+    for (size_t i = 0; i < strings.size(); ++i) {
+        MapFileString entry = { blob, (uint32_t)strings[i].size() };
+        put(out, at + i * sizeof(MapFileString), entry);
+        std::memcpy(out.data() + at + blob, strings[i].data(), strings[i].size());
+        blob += (uint32_t)strings[i].size();
+    }
+}
+
+static bool get_strings(const uint8_t* base, const MapFileSection& section, std::vector<std::string>& strings)
+{
+    if (section.size / sizeof(MapFileString) < section.count)
+        return false;
+    strings.resize(section.count);
+    for (uint32_t i = 0; i < section.count; ++i) {
+        MapFileString entry;
+        if (!get(base, section.size, i * sizeof(MapFileString), entry))
+            return false;
+        if (entry.offset > section.size || section.size - entry.offset < entry.length)
+            return false;
+        strings[i].assign(reinterpret_cast<const char*>(base + entry.offset), entry.length);
+    }
+    return true;
+}
+
+bool MapEntities::place(const std::string& prefab, int x, int y, eZone zone)
+{
+    if ((int)zone < 0 || (int)zone >= ZONE_COUNT)
+        return false;
+    auto it = std::find(prefabs.begin(), prefabs.end(), prefab);
+    size_t index = it - prefabs.begin();
+    if (index > UINT16_MAX)
+        return false;
+
+    erase_at(x, y);
+    if (it == prefabs.end())
+        prefabs.push_back(prefab);
+    placed.push_back({ x, y, (uint16_t)index, (uint8_t)zone, 0 });
+    version++;
+    return true;
+}
+
+bool MapEntities::erase_at(int x, int y)
+{
+    auto it = std::find_if(placed.begin(), placed.end(), [&](const MapFileEntity& e) { return e.x == x && e.y == y; });
+    if (it == placed.end())
+        return false;
+    placed.erase(it);
+    version++;
+    return true;
+}
+
+void MapEntities::clear()
+{
+    prefabs.clear();
+    placed.clear();
+    version++;
+}
+
+std::vector<uint8_t> encode_map_file(const TileLayers& layers, const std::vector<std::string>& textureNames, const MapEntities& entities)
+{
+    // Write only textures actually used in the map, remapped to a dense table
+    std::vector<int> fileIndex(textureNames.size(), -1);
+    std::vector<std::string> strings;
+    struct ChunkRef {
+        int layer;
+        uint64_t key;
+    };
+    std::vector<ChunkRef> refs;
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        layers[layer].for_each_chunk([&](int cx, int cy, const TileChunk& chunk) {
+            refs.push_back({ layer, TileGrid::chunk_key(cx, cy) });
+            for (const Tile& t : chunk.tiles) {
+                int tex = t.textureIndex();
+                if (t.empty() || tex < 0 || tex >= (int)textureNames.size())
+                    continue;
+                if (fileIndex[tex] < 0) {
+                    fileIndex[tex] = (int)strings.size();
+                    strings.push_back(textureNames[tex]);
+                }
+            }
+        });
+    }
+
+    // Layer by layer, row-major chunk order within each keeps the file stable between saves
+    std::sort(refs.begin(), refs.end(), [](const ChunkRef& a, const ChunkRef& b) {
+        if (a.layer != b.layer)
+            return a.layer < b.layer;
+        int ay = TileGrid::key_cy(a.key), by = TileGrid::key_cy(b.key);
+        return ay != by ? ay < by : TileGrid::key_cx(a.key) < TileGrid::key_cx(b.key);
+    });
+
+    const int tileCount = CHUNK_SIZE * CHUNK_SIZE;
+    const size_t tileBytes = sizeof(MapFileTile) * tileCount;
+
+    // Chunks compress independently, one job per chunk
+    std::vector<std::vector<uint8_t>> payloads(refs.size());
+    std::vector<uint32_t> encodings(refs.size());
+    parallel_for(refs.size(), [&](size_t i) {
+        const TileChunk* chunk = layers[refs[i].layer].find_chunk(TileGrid::key_cx(refs[i].key), TileGrid::key_cy(refs[i].key));
+
+        // Files are row-major whatever the in-memory chunk order
+        std::vector<MapFileTile> tiles(tileCount);
+        for (int n = 0; n < tileCount; ++n) {
+            const TileKind& kind = tile_table[chunk->tiles[TileChunk::index(n % CHUNK_SIZE, n / CHUNK_SIZE)].id];
+            bool painted = kind.type >= 0 && kind.textureIndex >= 0 && kind.textureIndex < (int)fileIndex.size();
+            tiles[n].type = painted ? kind.type : -1;
+            tiles[n].texture = painted ? (int16_t)fileIndex[kind.textureIndex] : -1;
+        }
+
+        std::vector<uint8_t> packed = pack_chunk(tiles.data(), tileCount);
+        if (packed.size() < tileBytes) {
+            payloads[i] = std::move(packed);
+            encodings[i] = CHUNK_ENCODING_PACKED;
+        } else {
+            const uint8_t* raw = reinterpret_cast<const uint8_t*>(tiles.data());
+            payloads[i].assign(raw, raw + tileBytes);
+            encodings[i] = CHUNK_ENCODING_RAW;
+        }
+    });
+
+    // One chunk section per layer that has chunks, refs[first[l], first[l + 1]) belong to layer l
+    int first[LAYER_COUNT + 1] = {};
+    for (const ChunkRef& ref : refs)
+        first[ref.layer + 1]++;
+    for (int l = 0; l < LAYER_COUNT; ++l)
+        first[l + 1] += first[l];
+    int usedLayers = 0;
+    for (int l = 0; l < LAYER_COUNT; ++l)
+        usedLayers += first[l + 1] > first[l];
+
+    // Collision rectangles, in chunk order like the chunks themselves
+    std::vector<TileRect> collision;
+    for (int i = first[LAYER_COLLISION]; i < first[LAYER_COLLISION + 1]; ++i) {
+        int cx = TileGrid::key_cx(refs[i].key), cy = TileGrid::key_cy(refs[i].key);
+        merge_solid_cells(*layers[LAYER_COLLISION].find_chunk(cx, cy), cx, cy, layers.width(), layers.height(), collision);
+    }
+
+    bool hasEntities = !entities.placed.empty();
+    uint32_t sectionCount = 1 + usedLayers + !collision.empty() + 2 * hasEntities;
+    size_t stringsOffset = align8(sizeof(MapFileHeader) + sectionCount * sizeof(MapFileSection));
+    size_t stringsSize = strings_size(strings);
+
+    size_t tableOffsets[LAYER_COUNT] = {};
+    size_t total = align8(stringsOffset + stringsSize);
+    for (int l = 0; l < LAYER_COUNT; ++l) {
+        tableOffsets[l] = total;
+        total = align8(total + sizeof(MapFileChunk) * (first[l + 1] - first[l]));
+    }
+    std::vector<uint64_t> dataOffsets(refs.size());
+    for (size_t i = 0; i < refs.size(); ++i) {
+        dataOffsets[i] = total;
+        total = align8(total + payloads[i].size());
+    }
+    size_t collisionOffset = total;
+    size_t collisionSize = sizeof(MapFileRect) * collision.size();
+    total = align8(total + collisionSize);
+    size_t prefabsOffset = total;
+    size_t prefabsSize = strings_size(entities.prefabs);
+    total = align8(total + prefabsSize);
+    size_t entitiesOffset = total;
+    size_t entitiesSize = sizeof(MapFileEntity) * entities.placed.size();
+    total = align8(total + entitiesSize);
+
+    std::vector<uint8_t> out(total, 0);
+
+    MapFileHeader header = {};
+    header.magic = MAP_FILE_MAGIC;
+    header.version = MAP_FILE_VERSION;
+    header.chunk_size = CHUNK_SIZE;
+    header.width = layers.width();
+    header.height = layers.height();
+    header.section_count = sectionCount;
+    put(out, 0, header);
+
+    size_t sectionAt = sizeof(MapFileHeader);
+    MapFileSection stringSection = { MAP_SECTION_STRINGS, (uint32_t)strings.size(), stringsOffset, stringsSize };
+    put(out, sectionAt, stringSection);
+    for (int l = 0; l < LAYER_COUNT; ++l) {
+        uint32_t count = first[l + 1] - first[l];
+        if (count == 0)
+            continue;
+        sectionAt += sizeof(MapFileSection);
+        MapFileSection chunkSection = { MAP_SECTION_CHUNKS | (uint32_t)l << MAP_SECTION_LAYER_SHIFT, count, tableOffsets[l], sizeof(MapFileChunk) * count };
+        put(out, sectionAt, chunkSection);
+    }
+    if (!collision.empty()) {
+        sectionAt += sizeof(MapFileSection);
+        MapFileSection collisionSection = { MAP_SECTION_COLLISION, (uint32_t)collision.size(), collisionOffset, collisionSize };
+        put(out, sectionAt, collisionSection);
+    }
+    if (hasEntities) {
+        sectionAt += sizeof(MapFileSection);
+        MapFileSection prefabSection = { MAP_SECTION_PREFABS, (uint32_t)entities.prefabs.size(), prefabsOffset, prefabsSize };
+        put(out, sectionAt, prefabSection);
+        sectionAt += sizeof(MapFileSection);
+        MapFileSection entitySection = { MAP_SECTION_ENTITIES, (uint32_t)entities.placed.size(), entitiesOffset, entitiesSize };
+        put(out, sectionAt, entitySection);
+    }
+
+    put_strings(out, stringsOffset, strings);
+
+    // Chunk tables + payloads
+    for (size_t i = 0; i < refs.size(); ++i) {
+        int l = refs[i].layer;
+        MapFileChunk entry = {
+            TileGrid::key_cx(refs[i].key),
+            TileGrid::key_cy(refs[i].key),
+            encodings[i],
+            (uint32_t)payloads[i].size(),
+            dataOffsets[i]
+        };
+        put(out, tableOffsets[l] + (i - first[l]) * sizeof(MapFileChunk), entry);
+        std::memcpy(out.data() + dataOffsets[i], payloads[i].data(), payloads[i].size());
+    }
+
+    for (size_t i = 0; i < collision.size(); ++i) {
+        MapFileRect rect = { collision[i].x0, collision[i].y0, collision[i].x1, collision[i].y1 };
+        put(out, collisionOffset + i * sizeof(MapFileRect), rect);
+    }
+
+    if (hasEntities) {
+        put_strings(out, prefabsOffset, entities.prefabs);
+        std::memcpy(out.data() + entitiesOffset, entities.placed.data(), entitiesSize);
+    }
+
+    return out;
+}
+
+bool write_map_file(const std::string& path, const std::vector<uint8_t>& bytes)
+{
+    // Write next to the target and rename over it, so a crash mid-save leaves
+    // either the old file or the new one, never a truncated mix
+    std::string tmpPath = path + ".tmp";
+    FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        TraceLog(LOG_ERROR, "Can't open %s for writing", tmpPath.c_str());
+        return false;
+    }
+
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    ok = (std::fflush(file) == 0) && ok;
+#ifdef _WIN32
+    ok = (_commit(_fileno(file)) == 0) && ok;
+#else
+    ok = (fsync(fileno(file)) == 0) && ok;
+#endif
+    ok = (std::fclose(file) == 0) && ok;
+
+    std::error_code ec;
+    if (ok)
+        std::filesystem::rename(tmpPath, path, ec);
+    if (!ok || ec) {
+        TraceLog(LOG_ERROR, "Failed to write %s", path.c_str());
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+
+#ifndef _WIN32
+    // Persist the rename itself
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    int dirFd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+#endif
+    return true;
+}
+
+// Numbers the (type, texture) pairs of one file into MapFileContents::kinds, the way tile_table numbers them process-wide
+class FileTileKinds {
+
+public:
+    explicit FileTileKinds(std::vector<TileKind>& kinds)
+        : kinds(kinds)
+    {
+        kinds.assign(1, TileKind {});
+    }
+
+    // 0 for empty tiles, -1 when the file holds more pairs than a tile id can tell apart
+    int intern(const MapFileTile& t)
+    {
+        if (t.type < 0)
+            return 0;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = ids.find(tile_bits(t));
+        if (it != ids.end())
+            return it->second;
+        if (kinds.size() >= TileTable::CAPACITY)
+            return -1;
+        kinds.push_back({ t.type, t.texture });
+        ids.emplace(tile_bits(t), (uint16_t)(kinds.size() - 1));
+        return (int)kinds.size() - 1;
+    }
+
+private:
+    std::mutex mutex;
+    std::unordered_map<uint32_t, uint16_t> ids;
+    std::vector<TileKind>& kinds;
+};
+
+void MapFileContents::resolve_tiles(const std::vector<int>& textureRemap)
+{
+    // Once per pair, not per cell
+    std::vector<uint16_t> ids(kinds.size(), 0);
+    for (size_t i = 1; i < kinds.size(); ++i) {
+        int tex = kinds[i].textureIndex;
+        ids[i] = tile_table.intern(kinds[i].type, (tex >= 0 && tex < (int)textureRemap.size()) ? textureRemap[tex] : -1);
+    }
+    for (TileGrid& grid : layers.grids)
+        grid.remap_ids(ids);
+    kinds.assign(1, TileKind {});
+}
+
+// nullptr when the chunk's data is corrupt
+static std::unique_ptr<TileChunk> decode_chunk(const uint8_t* data, const MapFileChunk& entry, FileTileKinds& fileKinds)
+{
+    constexpr int count = CHUNK_SIZE * CHUNK_SIZE;
+    std::vector<MapFileTile> tiles(count);
+    bool ok = false;
+    if (entry.encoding == CHUNK_ENCODING_RAW && entry.size == sizeof(MapFileTile) * count) {
+        std::memcpy(tiles.data(), data + entry.offset, entry.size);
+        ok = true;
+    } else if (entry.encoding == CHUNK_ENCODING_PACKED) {
+        ok = unpack_chunk(data + entry.offset, entry.size, tiles.data(), count);
+    }
+    if (!ok)
+        return nullptr;
+
+    // One pass straight into a new chunk, interning only when the tile differs from the previous one (runs are the norm)
+    auto chunk = std::make_unique<TileChunk>();
+    uint32_t lastBits = tile_bits({ -1, -1 });
+    int lastId = 0;
+    for (int n = 0; n < count; ++n) {
+        uint32_t bits = tile_bits(tiles[n]);
+        if (bits != lastBits) {
+            lastBits = bits;
+            lastId = fileKinds.intern(tiles[n]);
+            if (lastId < 0)
+                return nullptr;
+        }
+        chunk->tiles[TileChunk::index(n % CHUNK_SIZE, n / CHUNK_SIZE)].id = (uint16_t)lastId;
+    }
+    return chunk;
+}
+
+static bool read_v2(const uint8_t* data, size_t size, MapFileContents& out)
+{
+    MapFileHeader header;
+    if (!get(data, size, 0, header))
+        return false;
+
+    if (header.version < 2 || header.version > MAP_FILE_VERSION) {
+        TraceLog(LOG_ERROR, "Unsupported map version %d", header.version);
+        return false;
+    }
+    if (header.chunk_size != CHUNK_SIZE) {
+        TraceLog(LOG_ERROR, "Unsupported map chunk size %d", header.chunk_size);
+        return false;
+    }
+    if (header.width <= 0 || header.height <= 0 || header.width > MAP_MAX_SIZE || header.height > MAP_MAX_SIZE)
+        return false;
+    if (header.section_count > (size - sizeof(MapFileHeader)) / sizeof(MapFileSection))
+        return false;
+
+    out.version = header.version;
+    out.layers.reset(header.width, header.height);
+    FileTileKinds fileKinds(out.kinds);
+
+    for (uint32_t s = 0; s < header.section_count; ++s) {
+        MapFileSection section;
+        if (!get(data, size, sizeof(MapFileHeader) + s * sizeof(MapFileSection), section))
+            return false;
+        if (section.offset > size || size - section.offset < section.size)
+            return false;
+
+        const uint8_t* base = data + section.offset;
+
+        if (section.type == MAP_SECTION_STRINGS) {
+            if (!get_strings(base, section, out.textures))
+                return false;
+        } else if ((section.type & MAP_SECTION_KIND_MASK) == MAP_SECTION_CHUNKS && (section.type >> MAP_SECTION_LAYER_SHIFT) < LAYER_COUNT) {
+            TileGrid& grid = out.layers[section.type >> MAP_SECTION_LAYER_SHIFT];
+            // At most one entry per chunk of the map, all inside it
+            if (section.size / sizeof(MapFileChunk) < section.count || section.count > (uint64_t)grid.chunks_x() * grid.chunks_y())
+                return false;
+            std::vector<MapFileChunk> entries(section.count);
+            for (uint32_t i = 0; i < section.count; ++i) {
+                const MapFileChunk& entry = entries[i];
+                if (!get(base, section.size, i * sizeof(MapFileChunk), entries[i]))
+                    return false;
+                if (entry.offset > size || size - entry.offset < entry.size)
+                    return false;
+                if (entry.cx < 0 || entry.cy < 0 || entry.cx >= grid.chunks_x() || entry.cy >= grid.chunks_y())
+                    return false;
+            }
+
+            // Decode every chunk on the worker threads, only adopting them is serial
+            std::vector<std::unique_ptr<TileChunk>> built(entries.size());
+            std::atomic<bool> failed { false };
+            parallel_for(entries.size(), [&](size_t i) {
+                // Nothing may throw out of a worker, running out of memory fails the load like bad data does
+                try {
+                    built[i] = decode_chunk(data, entries[i], fileKinds);
+                } catch (const std::bad_alloc&) {
+                    built[i] = nullptr;
+                }
+                if (!built[i])
+                    failed = true;
+            });
+
+            if (failed)
+                return false;
+
+            for (size_t i = 0; i < entries.size(); ++i)
+                grid.adopt(entries[i].cx, entries[i].cy, std::move(built[i]));
+        } else if (section.type == MAP_SECTION_COLLISION) {
+            if (section.size / sizeof(MapFileRect) < section.count)
+                return false;
+            out.collision.resize(section.count);
+            for (uint32_t i = 0; i < section.count; ++i) {
+                MapFileRect rect;
+                if (!get(base, section.size, i * sizeof(MapFileRect), rect))
+                    return false;
+                out.collision[i] = { rect.x0, rect.y0, rect.x1, rect.y1 };
+            }
+            out.has_collision = true;
+        } else if (section.type == MAP_SECTION_PREFABS) {
+            if (!get_strings(base, section, out.entities.prefabs))
+                return false;
+        } else if (section.type == MAP_SECTION_ENTITIES) {
+            if (section.size / sizeof(MapFileEntity) < section.count)
+                return false;
+            out.entities.placed.resize(section.count);
+            std::memcpy(out.entities.placed.data(), base, sizeof(MapFileEntity) * section.count);
+        }
+        // Unknown sections are skipped so newer minor additions stay readable
+    }
+
+    // Placements naming a prefab the file doesn't list would index out of the table,
+    // those in a zone that doesn't exist would make entities nothing can reach
+    for (const MapFileEntity& e : out.entities.placed) {
+        if (e.prefab >= out.entities.prefabs.size() || e.zone >= ZONE_COUNT)
+            return false;
+    }
+    return true;
+}
+
+/*
+Headerless layout (map1.bin, map2.bin):
+    [int] textureCount
+    For each texture:
+        [int] nameLength
+        [char * nameLength] textureName
+    For each tile (y-major):
+        [int] type
+        [int] textureIndex
+    [int] width, [int] height, [int] "WDIM"      (optional)
+*/
+static bool read_legacy(const uint8_t* data, size_t size, MapFileContents& out)
+{
+    size_t at = 0;
+    int32_t texCount = 0;
+    // Every name takes at least its length field
+    if (!get(data, size, at, texCount) || texCount < 0 || (size_t)texCount > size / sizeof(int32_t))
+        return false;
+    at += sizeof(int32_t);
+
+    out.textures.resize(texCount);
+    for (int i = 0; i < texCount; ++i) {
+        int32_t len = 0;
+        if (!get(data, size, at, len) || len < 0 || size - at - sizeof(int32_t) < (size_t)len)
+            return false;
+        at += sizeof(int32_t);
+        out.textures[i].assign(reinterpret_cast<const char*>(data + at), len);
+        at += len;
+    }
+
+    // Map size comes from the footer, or is inferred from the tile count
+    size_t tileBytes = size - at;
+    int mapW = 0;
+    int mapH = 0;
+    int32_t footer[3] = {};
+    if (tileBytes >= sizeof(footer)) {
+        std::memcpy(footer, data + size - sizeof(footer), sizeof(footer));
+        if (footer[2] == LEGACY_SIZE_TAG && footer[0] > 0 && footer[1] > 0) {
+            mapW = footer[0];
+            mapH = footer[1];
+            tileBytes -= sizeof(footer);
+        }
+    }
+    if (mapW == 0) {
+        int count = (int)(tileBytes / (2 * sizeof(int32_t)));
+        int side = (int)std::lround(std::sqrt((double)count));
+        if (side * side == count) {
+            mapW = side;
+            mapH = side;
+        } else {
+            mapW = WORLD_WIDTH;
+            mapH = std::max(1, count / WORLD_WIDTH);
+        }
+    }
+
+    if (mapW > MAP_MAX_SIZE || mapH > MAP_MAX_SIZE)
+        return false;
+
+    out.version = 1;
+    out.layers.reset(mapW, mapH);
+    FileTileKinds fileKinds(out.kinds);
+
+    // Cells are gathered into chunks, then adopted like decoded ones
+    std::unordered_map<uint64_t, std::unique_ptr<TileChunk>> chunks;
+    size_t cells = std::min((size_t)mapW * mapH, tileBytes / (2 * sizeof(int32_t)));
+    for (size_t i = 0; i < cells; ++i) {
+        int32_t pair[2];
+        std::memcpy(pair, data + at + i * sizeof(pair), sizeof(pair));
+        // Pairs a tile id can't hold read as empty, as they always have
+        if (pair[0] < 0 || pair[0] > INT16_MAX || pair[1] < INT16_MIN || pair[1] > INT16_MAX)
+            continue;
+        int id = fileKinds.intern({ (int16_t)pair[0], (int16_t)pair[1] });
+        if (id < 0)
+            return false;
+
+        int x = (int)(i % mapW);
+        int y = (int)(i / mapW);
+        std::unique_ptr<TileChunk>& chunk = chunks[TileGrid::chunk_key(x / CHUNK_SIZE, y / CHUNK_SIZE)];
+        if (!chunk)
+            chunk = std::make_unique<TileChunk>();
+        chunk->tiles[TileChunk::index(x % CHUNK_SIZE, y % CHUNK_SIZE)].id = (uint16_t)id;
+    }
+    for (auto& [key, chunk] : chunks)
+        out.layers[LAYER_GROUND].adopt(TileGrid::key_cx(key), TileGrid::key_cy(key), std::move(chunk));
+
+    return true;
+}
+
+bool decode_map_file(const uint8_t* data, size_t size, MapFileContents& out)
+{
+    uint32_t magic = 0;
+    if (get(data, size, 0, magic) && magic == MAP_FILE_MAGIC)
+        return read_v2(data, size, out);
+    return read_legacy(data, size, out);
+}
+
+bool read_map_file(const std::string& path, MapFileContents& out)
+{
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+
+    bool ok = decode_map_file(file.data(), file.size(), out);
+    if (!ok)
+        TraceLog(LOG_ERROR, "Corrupt or truncated map file: %s", path.c_str());
+    return ok;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "tile_grid.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+map.bin v2 (little-endian, every section offset 8-byte aligned):
+
+    MapFileHeader
+    MapFileSection[section_count]
+
+    MAP_SECTION_STRINGS (count = number of texture names):
+        MapFileString[count]            offsets relative to the section start
+        [char...] name bytes
+
+    MAP_SECTION_CHUNKS | layer << 8, one per non-empty eMapLayer (count = number of stored chunks):
+        MapFileChunk[count]             offsets absolute
+        per chunk, by encoding:
+            CHUNK_ENCODING_RAW      MapFileTile[chunk_size * chunk_size], row-major
+            CHUNK_ENCODING_PACKED   [varint stream size] lz_compress(stream), where stream is
+                                    [varint palette count][u32 MapFileTile...]
+                                    then runs of [varint length][varint palette index]
+
+    MAP_SECTION_COLLISION (count = number of rectangles):
+        MapFileRect[count]              collision layer cells merged per chunk, in tiles, half-open
+
+    MAP_SECTION_PREFABS (count = number of prefab names):
+        same layout as MAP_SECTION_STRINGS
+
+    MAP_SECTION_ENTITIES (count = number of placed entities):
+        MapFileEntity[count]            prefab indexes into MAP_SECTION_PREFABS
+
+Tiles reference textures by their index in the string table, entities reference
+prefabs (see prefab.h) by name through theirs. The ground layer's
+section type is plain MAP_SECTION_CHUNKS, so version 3 readers still see it and skip
+the other layers. Files without the magic are read with the original headerless layout.
+
+chunk_size is always CHUNK_SIZE, and width and height at most MAP_MAX_SIZE. Files that
+say otherwise are rejected before anything is allocated for them.
+*/
+
+constexpr uint32_t MAP_FILE_MAGIC = 0x4d475052; // "RPGM"
+constexpr uint16_t MAP_FILE_VERSION = 5; // 3: packed chunk encoding, 4: layers, 5: entities
+
+enum eMapSection : uint32_t {
+    MAP_SECTION_STRINGS = 1,
+    MAP_SECTION_CHUNKS = 2,
+    MAP_SECTION_COLLISION = 3,
+    MAP_SECTION_PREFABS = 4,
+    MAP_SECTION_ENTITIES = 5,
+};
+
+// Low byte: eMapSection, the rest: layer of a chunk section
+constexpr uint32_t MAP_SECTION_KIND_MASK = 0xff;
+constexpr uint32_t MAP_SECTION_LAYER_SHIFT = 8;
+
+enum eChunkEncoding : uint32_t {
+    CHUNK_ENCODING_RAW = 0,
+    CHUNK_ENCODING_PACKED = 1,
+};
+
+struct MapFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t chunk_size;
+    int32_t width;
+    int32_t height;
+    uint32_t section_count;
+    uint32_t reserved;
+};
+
+struct MapFileSection {
+    uint32_t type;
+    uint32_t count;
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct MapFileString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct MapFileChunk {
+    int32_t cx;
+    int32_t cy;
+    uint32_t encoding;
+    uint32_t size; // bytes of tile data
+    uint64_t offset;
+};
+
+struct MapFileRect {
+    int32_t x0, y0;
+    int32_t x1, y1;
+};
+
+struct MapFileEntity {
+    int32_t x; // tile
+    int32_t y;
+    uint16_t prefab; // prefab table index
+    uint8_t zone; // eZone
+    uint8_t reserved;
+};
+
+struct MapFileTile {
+    int16_t type;
+    int16_t texture; // string table index, -1 for none
+};
+
+static_assert(sizeof(MapFileHeader) == 24, "map header layout changed");
+static_assert(sizeof(MapFileSection) == 24, "map section layout changed");
+static_assert(sizeof(MapFileChunk) == 24, "map chunk layout changed");
+static_assert(sizeof(MapFileTile) == 4, "map tile layout changed");
+static_assert(sizeof(MapFileRect) == 16, "map rect layout changed");
+static_assert(sizeof(MapFileEntity) == 12, "map entity layout changed");
+
+// Entities placed on a map, by prefab name. Placements are data only, the game instantiates them.
+struct MapEntities {
+    std::vector<std::string> prefabs; // indexed by MapFileEntity::prefab
+    std::vector<MapFileEntity> placed;
+    uint64_t version = 0; // bumped by every change
+
+    // Replaces whatever was placed on the tile. False, placing nothing, for a zone that doesn't
+    // exist or a new prefab name when MapFileEntity::prefab can't index another one.
+    bool place(const std::string& prefab, int x, int y, eZone zone);
+    // False when nothing was placed on the tile
+    bool erase_at(int x, int y);
+    void clear();
+};
+
+// Decoded file. Until resolve_tiles() the layers' tile ids index kinds, not tile_table,
+// so loading a map only adds the pairs it ends up using to the process-wide table.
+struct MapFileContents {
+    int version = 0; // 1 for the headerless layout
+    std::vector<std::string> textures;
+    TileLayers layers; // files before version 4 only fill the ground layer
+    std::vector<TileKind> kinds; // the file's (type, texture) pairs, textureIndex into textures, [0] = empty
+    std::vector<TileRect> collision; // baked collision rectangles, when the file has them
+    bool has_collision = false;
+    MapEntities entities;
+
+    // Points the layers at tile_table, with texture i of the file becoming textureRemap[i] (-1 for none)
+    void resolve_tiles(const std::vector<int>& textureRemap);
+};
+
+// Serializes layers and entities into a file image. Only textures used by the layers are stored,
+// textureNames is indexed by Tile::textureIndex. Chunks are packed in parallel
+// and stored raw only when packing doesn't make them smaller. The collision layer's
+// merged rectangles are stored too, so loading doesn't have to merge them again.
+std::vector<uint8_t> encode_map_file(const TileLayers& layers, const std::vector<std::string>& textureNames, const MapEntities& entities);
+// Atomically replaces path: writes path.tmp, syncs it to disk, then renames it over path
+bool write_map_file(const std::string& path, const std::vector<uint8_t>& bytes);
+
+// Maps the file and decodes either layout, chunks are unpacked in parallel
+bool read_map_file(const std::string& path, MapFileContents& out);
+// Same, for a file image already in memory (e.g. inside the asset pack)
+bool decode_map_file(const uint8_t* data, size_t size, MapFileContents& out);
@@ -0,0 +1,440 @@
+#include "map_journal.h"
+#include "compress.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <raylib.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static constexpr size_t HEADER_SIZE = 8;
+static constexpr size_t FRAME_HEADER_SIZE = 8;
+static constexpr size_t MIN_COMPACT_SIZE = 64 * 1024;
+
+static uint32_t fnv1a(const uint8_t* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t zigzag(int v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static int unzigzag(uint32_t v) { return (int)(v >> 1) ^ -(int)(v & 1); }
+
+static bool sync_file(FILE* file)
+{
+    if (std::fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+static size_t file_size_or_zero(const std::string& path)
+{
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    return ec ? 0 : (size_t)size;
+}
+
+// Length of the valid prefix of a journal image (header plus whole, intact frames), 0 if the header is bad
+static size_t valid_length(const uint8_t* data, size_t size)
+{
+    uint32_t magic;
+    uint16_t version;
+    if (size < HEADER_SIZE)
+        return 0;
+    std::memcpy(&magic, data, 4);
+    std::memcpy(&version, data + 4, 2);
+    if (magic != MAP_JOURNAL_MAGIC || version == 0 || version > MAP_JOURNAL_VERSION)
+        return 0;
+
+    size_t pos = HEADER_SIZE;
+    while (size - pos >= FRAME_HEADER_SIZE) {
+        uint32_t length, hash;
+        std::memcpy(&length, data + pos, 4);
+        std::memcpy(&hash, data + pos + 4, 4);
+        if (length > size - pos - FRAME_HEADER_SIZE)
+            break;
+        if (fnv1a(data + pos + FRAME_HEADER_SIZE, length) != hash)
+            break;
+        pos += FRAME_HEADER_SIZE + length;
+    }
+    return pos;
+}
+
+bool MapJournal::create(const std::string& path)
+{
+    file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    uint8_t header[HEADER_SIZE] = {};
+    std::memcpy(header, &MAP_JOURNAL_MAGIC, 4);
+    std::memcpy(header + 4, &MAP_JOURNAL_VERSION, 2);
+    std::fwrite(header, 1, HEADER_SIZE, file);
+    file_size = HEADER_SIZE;
+    carried_size = 0;
+    // Always name the layer in a new file, its frames may later be appended to another journal
+    current_layer = -1;
+    return std::fflush(file) == 0;
+}
+
+bool MapJournal::open(const std::string& mapPath)
+{
+    close();
+
+    std::string path = journal_path(mapPath);
+    size_t keep = 0;
+    {
+        MappedFile existing;
+        if (existing.open(path))
+            keep = valid_length(existing.data(), existing.size());
+    }
+
+    if (keep > 0) {
+        // Cut off a half-written frame so new frames stay readable
+        std::error_code ec;
+        if (keep != file_size_or_zero(path))
+            std::filesystem::resize_file(path, keep, ec);
+        file = std::fopen(path.c_str(), "ab");
+        file_size = keep;
+    } else if (!create(path)) {
+        file = nullptr;
+    }
+
+    if (!file) {
+        TraceLog(LOG_ERROR, "Can't open map journal %s", path.c_str());
+        return false;
+    }
+
+    base_path = mapPath;
+    old_size = file_size_or_zero(old_journal_path(mapPath));
+    map_size = file_size_or_zero(mapPath);
+    current_layer = -1; // whatever an appended-to file ended on
+    return true;
+}
+
+void MapJournal::close()
+{
+    if (!file)
+        return;
+
+    flush();
+    std::fclose(file);
+    file = nullptr;
+    base_path.clear();
+    defined.clear();
+    last_was_fill = false;
+    current_layer = -1;
+    file_size = carried_size = old_size = map_size = 0;
+}
+
+void MapJournal::define_texture(int textureIndex, const std::vector<std::string>& textureNames)
+{
+    if (textureIndex < 0 || textureIndex >= (int)textureNames.size())
+        return;
+    if (textureIndex < (int)defined.size() && defined[textureIndex])
+        return;
+
+    if (textureIndex >= (int)defined.size())
+        defined.resize(textureIndex + 1, false);
+    defined[textureIndex] = true;
+
+    const std::string& name = textureNames[textureIndex];
+    pending.push_back(JOURNAL_TEXTURE);
+    put_varint(pending, (uint32_t)textureIndex);
+    put_varint(pending, (uint32_t)name.size());
+    pending.insert(pending.end(), name.begin(), name.end());
+}
+
+void MapJournal::select_layer(int layer)
+{
+    if (layer == current_layer)
+        return;
+
+    pending.push_back(JOURNAL_LAYER);
+    put_varint(pending, (uint32_t)layer);
+    current_layer = layer;
+}
+
+void MapJournal::record_set(int layer, int x, int y, int type, int textureIndex, const std::vector<std::string>& textureNames)
+{
+    if (!file)
+        return;
+
+    if (type < 0)
+        textureIndex = -1;
+    define_texture(textureIndex, textureNames);
+    select_layer(layer);
+    pending.push_back(JOURNAL_SET);
+    put_varint(pending, (uint32_t)x);
+    put_varint(pending, (uint32_t)y);
+    put_varint(pending, zigzag(type));
+    put_varint(pending, zigzag(textureIndex));
+    last_was_fill = false;
+}
+
+void MapJournal::record_fill(int layer, int type, int textureIndex, const std::vector<std::string>& textureNames)
+{
+    if (!file)
+        return;
+
+    // Fill mode refills every frame the button is held, only the first one is news
+    if (last_was_fill && last_fill_layer == layer && last_fill_type == type && last_fill_texture == textureIndex)
+        return;
+
+    define_texture(textureIndex, textureNames);
+    select_layer(layer);
+    pending.push_back(JOURNAL_FILL);
+    put_varint(pending, zigzag(type));
+    put_varint(pending, zigzag(textureIndex));
+    last_was_fill = true;
+    last_fill_layer = layer;
+    last_fill_type = type;
+    last_fill_texture = textureIndex;
+}
+
+void MapJournal::record_clear()
+{
+    if (!file)
+        return;
+
+    pending.push_back(JOURNAL_CLEAR);
+    last_was_fill = false;
+}
+
+void MapJournal::record_resize(int width, int height)
+{
+    if (!file)
+        return;
+
+    pending.push_back(JOURNAL_RESIZE);
+    put_varint(pending, (uint32_t)width);
+    put_varint(pending, (uint32_t)height);
+    last_was_fill = false;
+}
+
+bool MapJournal::flush()
+{
+    if (!file || pending.empty())
+        return true;
+
+    uint32_t frame[2] = { (uint32_t)pending.size(), fnv1a(pending.data(), pending.size()) };
+    bool ok = std::fwrite(frame, 1, FRAME_HEADER_SIZE, file) == FRAME_HEADER_SIZE;
+    ok = ok && std::fwrite(pending.data(), 1, pending.size(), file) == pending.size();
+    ok = ok && std::fflush(file) == 0;
+
+    file_size += FRAME_HEADER_SIZE + pending.size();
+    pending.clear();
+    if (!ok)
+        TraceLog(LOG_ERROR, "Failed to append to map journal for %s", base_path.c_str());
+    return ok;
+}
+
+bool MapJournal::sync()
+{
+    if (!file)
+        return false;
+
+    pending.push_back(JOURNAL_SAVED);
+    last_was_fill = false;
+    return flush() && sync_file(file);
+}
+
+bool MapJournal::should_compact() const
+{
+    // Only the live journal counts, a failed compaction must not retry every frame
+    return file && file_size - carried_size > std::max(MIN_COMPACT_SIZE, map_size / 4);
+}
+
+bool MapJournal::begin_compaction(const std::string& mapPath)
+{
+    if (file && base_path != mapPath)
+        close(); // edits of the previous file stay in its own journal
+
+    flush();
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    std::string path = journal_path(mapPath);
+    std::string oldPath = old_journal_path(mapPath);
+    std::error_code ec;
+
+    if (std::filesystem::exists(path, ec)) {
+        if (!std::filesystem::exists(oldPath, ec)) {
+            std::filesystem::rename(path, oldPath, ec);
+        } else {
+            // A previous compaction failed, its journal still matters: append this one to it
+            MappedFile current;
+            FILE* old = std::fopen(oldPath.c_str(), "ab");
+            if (old && current.open(path)) {
+                size_t length = valid_length(current.data(), current.size());
+                if (length > HEADER_SIZE)
+                    std::fwrite(current.data() + HEADER_SIZE, 1, length - HEADER_SIZE, old);
+                sync_file(old);
+            }
+            if (old)
+                std::fclose(old);
+            current.close();
+            std::filesystem::remove(path, ec);
+        }
+    }
+
+    defined.clear();
+    last_was_fill = false;
+    base_path = mapPath;
+    old_size = file_size_or_zero(oldPath);
+    if (!create(path)) {
+        TraceLog(LOG_ERROR, "Can't create map journal %s", path.c_str());
+        if (file)
+            std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool MapJournal::carry_over()
+{
+    if (!file)
+        return false;
+
+    last_was_fill = false;
+    bool ok = flush() && sync_file(file);
+    carried_size = file_size;
+    return ok;
+}
+
+void MapJournal::end_compaction(const std::string& mapPath, bool ok)
+{
+    if (!ok)
+        return; // keep the old journal, it is replayed on top of the old map file
+
+    std::error_code ec;
+    std::filesystem::remove(old_journal_path(mapPath), ec);
+    if (mapPath == base_path) {
+        old_size = 0;
+        map_size = file_size_or_zero(mapPath);
+    }
+}
+
+static void replay_file(const std::string& path, TileLayers& layers, const std::function<int(const std::string&)>& resolve, MapJournal::ReplayStats& stats)
+{
+    MappedFile mapped;
+    if (!mapped.open(path))
+        return;
+
+    const uint8_t* data = mapped.data();
+    size_t length = valid_length(data, mapped.size());
+    if (length == 0) {
+        TraceLog(LOG_WARNING, "Ignoring invalid map journal %s", path.c_str());
+        return;
+    }
+
+    // File texture index -> runtime index, redefined as the records go
+    std::vector<int> textures;
+    auto texture = [&](int index) {
+        return (index >= 0 && index < (int)textures.size()) ? textures[index] : -1;
+    };
+
+    TileGrid* grid = &layers[LAYER_GROUND];
+
+    size_t pos = HEADER_SIZE;
+    while (pos < length) {
+        uint32_t size;
+        std::memcpy(&size, data + pos, 4);
+        const uint8_t* p = data + pos + FRAME_HEADER_SIZE;
+        const uint8_t* end = p + size;
+        pos += FRAME_HEADER_SIZE + size;
+
+        while (p < end) {
+            uint8_t type = *p++;
+            uint32_t a = 0, b = 0, c = 0, d = 0;
+            bool ok = true;
+
+            switch (type) {
+            case JOURNAL_TEXTURE:
+                ok = get_varint(p, end, a) && get_varint(p, end, b) && b <= (uint32_t)(end - p);
+                if (ok) {
+                    std::string name((const char*)p, b);
+                    p += b;
+                    if (a >= textures.size())
+                        textures.resize(a + 1, -1);
+                    textures[a] = resolve(name);
+                }
+                break;
+            case JOURNAL_SET:
+                ok = get_varint(p, end, a) && get_varint(p, end, b) && get_varint(p, end, c) && get_varint(p, end, d);
+                if (ok)
+                    grid->set((int)a, (int)b, unzigzag(c), texture(unzigzag(d)));
+                break;
+            case JOURNAL_FILL:
+                ok = get_varint(p, end, a) && get_varint(p, end, b);
+                if (ok)
+                    grid->fill(unzigzag(a), texture(unzigzag(b)));
+                break;
+            case JOURNAL_CLEAR:
+                layers.clear();
+                break;
+            case JOURNAL_SAVED:
+                stats.unsaved = 0;
+                stats.saved_version = layers.version();
+                stats.saved = layers.snapshot();
+                break;
+            case JOURNAL_RESIZE:
+                // Sizes no map file could hold mean the record is corrupt, like an oversized header
+                ok = get_varint(p, end, a) && get_varint(p, end, b) && a >= 1 && b >= 1 && a <= MAP_MAX_SIZE && b <= MAP_MAX_SIZE;
+                if (ok)
+                    layers.resize((int)a, (int)b);
+                break;
+            case JOURNAL_LAYER:
+                ok = get_varint(p, end, a) && a < LAYER_COUNT;
+                if (ok)
+                    grid = &layers[a];
+                break;
+            default:
+                ok = false;
+                break;
+            }
+
+            if (!ok) {
+                TraceLog(LOG_WARNING, "Malformed record in map journal %s", path.c_str());
+                return;
+            }
+            if (type != JOURNAL_TEXTURE && type != JOURNAL_SAVED && type != JOURNAL_LAYER) {
+                stats.records++;
+                stats.unsaved++;
+            }
+        }
+    }
+}
+
+MapJournal::ReplayStats MapJournal::replay(const std::string& mapPath, TileLayers& layers, const std::function<int(const std::string&)>& resolve)
+{
+    ReplayStats stats;
+    stats.saved_version = layers.version();
+    stats.saved = layers.snapshot();
+    replay_file(old_journal_path(mapPath), layers, resolve, stats);
+    replay_file(journal_path(mapPath), layers, resolve, stats);
+    return stats;
+}
+
+void MapJournal::discard(const std::string& mapPath)
+{
+    std::error_code ec;
+    std::filesystem::remove(journal_path(mapPath), ec);
+    std::filesystem::remove(old_journal_path(mapPath), ec);
+}
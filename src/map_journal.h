@@ -0,0 +1,123 @@
+#pragma once
+
+#include "tile_grid.h"
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+<map>.journal (little-endian), append-only log of edits made since the map file was last written:
+
+    u32 magic, u16 version, u16 reserved
+    frames, one per flush():
+        u32 payload size, u32 FNV-1a of payload, payload = records
+
+    records start with a u8 eJournalRecord, ints are varints (type/texture zigzag encoded):
+        JOURNAL_TEXTURE   index, name length, name bytes   (names the index for the following records)
+        JOURNAL_SET       x, y, type, texture
+        JOURNAL_FILL      type, texture
+        JOURNAL_CLEAR                                      (all layers)
+        JOURNAL_RESIZE    width, height                    (all layers)
+        JOURNAL_SAVED                                      (the user saved here, later records are unsaved edits)
+        JOURNAL_LAYER     layer                            (v2, SET and FILL records that follow apply to it)
+
+SET and FILL apply to the ground layer until a JOURNAL_LAYER record says otherwise,
+which is how every v1 journal reads.
+
+Every record stores absolute values, so replaying a journal over a map that already
+contains its edits is harmless. Replay stops at the first torn or corrupt frame.
+
+While the map file is being rewritten the journal is moved to <map>.journal.old and a
+fresh one is started, the old one is deleted once the new map file is safely on disk.
+A compaction only ever writes what the user last saved: the edits made since then are
+recorded again at the start of the fresh journal, so they replay as unsaved.
+*/
+
+constexpr uint32_t MAP_JOURNAL_MAGIC = 0x4a475052; // "RPGJ"
+constexpr uint16_t MAP_JOURNAL_VERSION = 2;
+
+enum eJournalRecord : uint8_t {
+    JOURNAL_TEXTURE = 1,
+    JOURNAL_SET = 2,
+    JOURNAL_FILL = 3,
+    JOURNAL_CLEAR = 4,
+    JOURNAL_RESIZE = 5,
+    JOURNAL_SAVED = 6,
+    JOURNAL_LAYER = 7,
+};
+
+class MapJournal {
+
+public:
+    MapJournal() = default;
+    ~MapJournal() { close(); }
+
+    MapJournal(const MapJournal&) = delete;
+    MapJournal& operator=(const MapJournal&) = delete;
+
+    static std::string journal_path(const std::string& mapPath) { return mapPath + ".journal"; }
+    static std::string old_journal_path(const std::string& mapPath) { return mapPath + ".journal.old"; }
+
+    // Starts appending to mapPath's journal, dropping a torn tail left by a crash
+    bool open(const std::string& mapPath);
+    void close();
+    bool is_open() const { return file != nullptr; }
+    const std::string& map_path() const { return base_path; }
+
+    // Recording does nothing while closed. textureNames is indexed by Tile::textureIndex.
+    void record_set(int layer, int x, int y, int type, int textureIndex, const std::vector<std::string>& textureNames);
+    void record_fill(int layer, int type, int textureIndex, const std::vector<std::string>& textureNames);
+    void record_clear();
+    void record_resize(int width, int height);
+
+    // Appends the buffered records as one frame, enough to survive the process dying
+    bool flush();
+    // Marks the edits so far as saved by the user, then flush() and fsync
+    bool sync();
+
+    // Bytes appended since the map file was last rewritten
+    size_t size() const { return file_size + old_size; }
+    // True once replaying the journal costs more than rewriting the map file
+    bool should_compact() const;
+
+    // Call right before snapshotting the layers for a full save to mapPath: later edits go to a fresh journal
+    bool begin_compaction(const std::string& mapPath);
+    // Call after recording the still unsaved edits into that fresh journal: makes them durable
+    // before the old journal can go, and keeps them from counting toward the next compaction
+    bool carry_over();
+    // Call with the result of that save, the old journal is dropped once the map file holds its edits
+    void end_compaction(const std::string& mapPath, bool ok);
+
+    struct ReplayStats {
+        int records = 0;
+        int unsaved = 0; // records after the last JOURNAL_SAVED
+        uint64_t saved_version = 0; // layers.version() at the last JOURNAL_SAVED
+        TileLayers saved; // snapshot of the layers at the last JOURNAL_SAVED
+    };
+
+    // Applies mapPath's pending journals to layers, resolve maps a texture name to a runtime index
+    static ReplayStats replay(const std::string& mapPath, TileLayers& layers, const std::function<int(const std::string&)>& resolve);
+    // Deletes mapPath's journals, for when the map file was replaced by something that doesn't know about them
+    static void discard(const std::string& mapPath);
+
+private:
+    void define_texture(int textureIndex, const std::vector<std::string>& textureNames);
+    void select_layer(int layer);
+    bool create(const std::string& path);
+
+    FILE* file = nullptr;
+    std::string base_path;
+    std::vector<uint8_t> pending;
+    std::vector<bool> defined; // texture indices already named in the current file
+    size_t file_size = 0;
+    size_t carried_size = 0; // bytes of file_size carried over from the previous journal
+    size_t old_size = 0;
+    size_t map_size = 0; // size of the map file, to decide when to compact
+    int current_layer = -1; // layer the file's next SET/FILL lands on, -1 when unknown
+    int last_fill_layer = -1;
+    int last_fill_type = -1;
+    int last_fill_texture = -1;
+    bool last_was_fill = false;
+};
@@ -0,0 +1,92 @@
+#include "map_saver.h"
+#include "map_format.h"
+#include <algorithm>
+#include <chrono>
+#include <raylib.h>
+
+MapSaver::MapSaver()
+    : worker(&MapSaver::run, this)
+{
+}
+
+MapSaver::~MapSaver()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void MapSaver::save(const std::string& path, TileLayers snapshot, std::vector<std::string> textureNames, MapEntities entities, eSaveKind kind)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::find_if(queue.begin(), queue.end(), [&](const Job& job) { return job.path == path; });
+        if (it == queue.end())
+            it = queue.insert(queue.end(), Job {});
+
+        it->path = path;
+        it->layers = std::move(snapshot);
+        it->textureNames = std::move(textureNames);
+        it->entities = std::move(entities);
+        it->kind = kind;
+    }
+    wake.notify_one();
+}
+
+bool MapSaver::busy() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return working || !queue.empty();
+}
+
+bool MapSaver::poll_result(Result& out)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (results.empty())
+        return false;
+
+    out = std::move(results.front());
+    results.erase(results.begin());
+    return true;
+}
+
+void MapSaver::run()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return quit || !queue.empty(); });
+            if (queue.empty())
+                return; // quit with nothing left to write
+
+            job = std::move(queue.front());
+            queue.erase(queue.begin());
+            working = true;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint8_t> bytes = encode_map_file(job.layers, job.textureNames, job.entities);
+        bool ok = write_map_file(job.path, bytes);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        Result result;
+        result.path = job.path;
+        result.ok = ok;
+        result.kind = job.kind;
+        result.version = job.layers.version();
+        result.entity_version = job.entities.version;
+        result.bytes = bytes.size();
+        result.seconds = elapsed.count();
+
+        // Release the snapshot before reporting, so the editor stops copying chunks on write
+        job = Job {};
+
+        std::lock_guard<std::mutex> lock(mutex);
+        results.push_back(std::move(result));
+        working = false;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "map_format.h"
+#include "tile_grid.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class eSaveKind {
+    Manual, // user requested full save (Save As)
+    Autosave, // periodic copy next to the map
+    Compact, // folds the edit journal back into the map file
+};
+
+// Encodes and writes maps on a worker thread. Jobs hold a snapshot of the layers,
+// so the editor can keep painting while a save is in flight.
+class MapSaver {
+
+public:
+    struct Result {
+        std::string path;
+        bool ok = false;
+        eSaveKind kind = eSaveKind::Manual;
+        uint64_t version = 0; // TileLayers::version() of the saved snapshot
+        uint64_t entity_version = 0; // MapEntities::version of the saved entities
+        size_t bytes = 0;
+        double seconds = 0.0;
+    };
+
+    MapSaver();
+    // Finishes the queued save before returning, so quitting never drops one
+    ~MapSaver();
+
+    MapSaver(const MapSaver&) = delete;
+    MapSaver& operator=(const MapSaver&) = delete;
+
+    // Queues a save, replacing a queued job that hasn't started yet
+    void save(const std::string& path, TileLayers snapshot, std::vector<std::string> textureNames, MapEntities entities, eSaveKind kind = eSaveKind::Manual);
+    bool busy() const;
+    // Pops the next finished save, call once per frame from the main thread
+    bool poll_result(Result& out);
+
+private:
+    struct Job {
+        std::string path;
+        TileLayers layers;
+        std::vector<std::string> textureNames;
+        MapEntities entities;
+        eSaveKind kind = eSaveKind::Manual;
+    };
+
+    void run();
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Job> queue; // at most one job per target path
+    std::vector<Result> results;
+    bool working = false;
+    bool quit = false;
+    std::thread worker;
+};
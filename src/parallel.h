@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Runs fn(i) for every i in [0, count) on up to one thread per core.
+// Work is handed out one index at a time, the calling thread takes part.
+template <typename Fn>
+void parallel_for(size_t count, Fn&& fn, size_t min_per_thread = 8)
+{
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    size_t workers = std::min(cores, (count + min_per_thread - 1) / min_per_thread);
+
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; ++i)
+            fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next { 0 };
+    auto run = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+            fn(i);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t w = 1; w < workers; ++w)
+        threads.emplace_back(run);
+    run();
+
+    for (std::thread& t : threads)
+        t.join();
+}
@@ -4,22 +4,25 @@
 #include "sprite_animation.h"
 #include "tile.h"
 
-void Player::load()
+void Player::load(ImageLoader& loader)
 {
-    Image idle_img = LoadImage(RESOURCES_PATH "char_idle.png");
-    Texture2D idle_tex = LoadTextureFromImage(idle_img);
-    anim_idle.init(idle_tex, 4, 2, 64, 0.25f, 1, true);
-    UnloadImage(idle_img);
-
-    Image walk_img = LoadImage(RESOURCES_PATH "char_run.png");
-    Texture2D walk_tex = LoadTextureFromImage(walk_img);
-    anim_walk.init(walk_tex, 4, 8, 64, 0.12f, 1, true);
-    UnloadImage(walk_img);
-
-    Image combat_img = LoadImage(RESOURCES_PATH "char_slash.png");
-    Texture2D combat_tex = LoadTextureFromImage(combat_img);
-    anim_combat.init(combat_tex, 4, 18, 64, 0.12f, 3, true);
-    UnloadImage(combat_img);
+    loader.request(RESOURCES_PATH "char_idle.png", [this](Image& img) {
+        TextureHandle sheet = assets.add_texture(RESOURCES_PATH "char_idle.png", img);
+        anim_idle.init(sheet, 4, 2, 64, 0.25f, 1, true);
+        assets.release(sheet);
+    });
+
+    loader.request(RESOURCES_PATH "char_run.png", [this](Image& img) {
+        TextureHandle sheet = assets.add_texture(RESOURCES_PATH "char_run.png", img);
+        anim_walk.init(sheet, 4, 8, 64, 0.12f, 1, true);
+        assets.release(sheet);
+    });
+
+    loader.request(RESOURCES_PATH "char_slash.png", [this](Image& img) {
+        TextureHandle sheet = assets.add_texture(RESOURCES_PATH "char_slash.png", img);
+        anim_combat.init(sheet, 4, 18, 64, 0.12f, 3, true);
+        assets.release(sheet);
+    });
 
     // Set default
     current_anim = &anim_idle;
@@ -128,17 +131,20 @@ void Player::update(float delta, Game& game)
         anim_combat.timer = 0.0f;
     }
 
-    // Movement collision (unchanged)
-    Rectangle nextHitbox = {
-        nextX + (TILE_WIDTH * 0.25f),
-        nextY + TILE_HEIGHT,
+    // Walls stop the move where they are hit, entities still block it outright
+    Rectangle moveHitbox = {
+        pos_x + (TILE_WIDTH * 0.25f),
+        pos_y + TILE_HEIGHT,
         static_cast<float>(TILE_WIDTH * 0.5f),
         static_cast<float>(TILE_HEIGHT)
     };
+    Vector2 step = game.map.collision.sweep(moveHitbox, { nextX - pos_x, nextY - pos_y });
+    moveHitbox.x += step.x;
+    moveHitbox.y += step.y;
 
-    if (game.can_move_to(nextHitbox) && !combatActive) {
-        pos_x = nextX;
-        pos_y = nextY;
+    if ((step.x != 0.0f || step.y != 0.0f) && game.can_move_to(moveHitbox) && !combatActive) {
+        pos_x += step.x;
+        pos_y += step.y;
         update_tile_index();
     }
 
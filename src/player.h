@@ -1,6 +1,7 @@
 #pragma once
 
 #include "entity.h"
+#include "image_loader.h"
 #include "sprite_animation.h"
 #include "tile.h"
 #include <string>
@@ -29,7 +30,8 @@ public:
     {
     }
 
-    void load();
+    // Sprite sheets are set up as loader finishes them
+    void load(ImageLoader& loader);
     void update(float delta, Game& game);
     void draw() override;
     void update_hitbox() override;
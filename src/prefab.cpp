@@ -0,0 +1,244 @@
+#include "prefab.h"
+#include "asset_pack.h"
+#include "entity.h"
+#include <fstream>
+#include <sstream>
+
+static bool parse_zone(const std::string& word, eZone& zone)
+{
+    if (word == "all")
+        zone = eZone::ALL;
+    else if (word == "world")
+        zone = eZone::WORLD;
+    else if (word == "dungeon")
+        zone = eZone::DUNGEON;
+    else
+        return false;
+    return true;
+}
+
+static bool parse_layer(const std::string& word, uint32_t& layer)
+{
+    if (word == "prop")
+        layer = COLLIDE_PROP;
+    else if (word == "npc")
+        layer = COLLIDE_NPC;
+    else if (word == "trap")
+        layer = COLLIDE_TRAP;
+    else if (word == "pickup")
+        layer = COLLIDE_PICKUP;
+    else
+        return false;
+    return true;
+}
+
+PrefabLibrary::~PrefabLibrary()
+{
+    clear();
+}
+
+void PrefabLibrary::clear()
+{
+    for (Prefab& prefab : prefabs) {
+        assets.release(std::get<Sprite>(prefab.values).sheet);
+        assets.release(std::get<Animation>(prefab.values).sheet);
+    }
+    prefabs.clear();
+    by_name.clear();
+}
+
+bool PrefabLibrary::load(const std::string& path)
+{
+    std::string text;
+    const PakEntry* cooked = asset_pack.find(path);
+    if (cooked && cooked->kind == PAK_DATA) {
+        text.assign((const char*)asset_pack.data(*cooked), cooked->size);
+    } else {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            TraceLog(LOG_ERROR, "Can't open prefabs %s", path.c_str());
+            return false;
+        }
+        text.assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    if (!parse(text, path))
+        return false;
+    TraceLog(LOG_INFO, "Prefabs loaded: %s (%d prefabs)", path.c_str(), (int)prefabs.size());
+    return true;
+}
+
+bool PrefabLibrary::parse(const std::string& text, const std::string& source)
+{
+    std::vector<Prefab> parsed;
+    std::vector<TextureHandle> sheets; // references taken while parsing, swapped for the prefabs' own at the end
+    auto sheet = [&](const std::string& name) {
+        TextureHandle handle = assets.load_texture(RESOURCES_PATH + name);
+        sheets.push_back(handle);
+        return handle;
+    };
+
+    std::istringstream lines(text);
+    std::string line;
+    int lineNumber = 0;
+    bool ok = true;
+    while (ok && std::getline(lines, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string key;
+        if (!(words >> key))
+            continue;
+
+        if (key.front() == '[') {
+            ok = key.size() > 2 && key.back() == ']';
+            if (ok) {
+                parsed.emplace_back();
+                parsed.back().name = key.substr(1, key.size() - 2);
+            }
+            continue;
+        }
+        if (parsed.empty()) {
+            ok = false;
+            break;
+        }
+
+        Prefab& prefab = parsed.back();
+        ComponentValues& v = prefab.values;
+        if (key == "sprite") {
+            std::string path;
+            Sprite& sprite = std::get<Sprite>(v);
+            ok = (bool)(words >> path >> sprite.src.x >> sprite.src.y >> sprite.src.width >> sprite.src.height);
+            if (ok) {
+                sprite.sheet = sheet(path);
+                prefab.signature |= COMPONENT_SPRITE;
+            }
+        } else if (key == "animation") {
+            std::string path;
+            Animation& anim = std::get<Animation>(v);
+            ok = (bool)(words >> path >> anim.rows >> anim.cols >> anim.size >> anim.frame_time);
+            if (ok && !(words >> anim.frame_span))
+                anim.frame_span = 1;
+            ok = ok && anim.rows > 0 && anim.cols > 0 && anim.frame_span > 0 && anim.frame_time > 0.0f;
+            if (ok) {
+                anim.sheet = sheet(path);
+                prefab.signature |= COMPONENT_ANIMATION;
+            }
+        } else if (key == "scale") {
+            ok = (bool)(words >> std::get<Position>(v).scale);
+        } else if (key == "health") {
+            Health& health = std::get<Health>(v);
+            ok = (bool)(words >> health.health >> health.damage >> health.points);
+            prefab.signature |= COMPONENT_HEALTH;
+        } else if (key == "collider") {
+            std::string layer, blocking;
+            Collider& collider = std::get<Collider>(v);
+            ok = (bool)(words >> layer) && parse_layer(layer, collider.layer);
+            collider.blocking = (words >> blocking) && blocking == "blocking";
+            prefab.signature |= COMPONENT_COLLIDER;
+        } else if (key == "lifetime") {
+            ok = (bool)(words >> std::get<Lifetime>(v).seconds);
+            prefab.signature |= COMPONENT_LIFETIME;
+        } else if (key == "portal") {
+            std::string a, b;
+            Portal& portal = std::get<Portal>(v);
+            ok = (bool)(words >> a >> b) && parse_zone(a, portal.a) && parse_zone(b, portal.b);
+            prefab.signature |= COMPONENT_PORTAL;
+        } else {
+            ok = false;
+        }
+    }
+
+    if (!ok)
+        TraceLog(LOG_ERROR, "%s:%d: can't read \"%s\"", source.c_str(), lineNumber, line.c_str());
+
+    // A sheet named twice in one prefab only keeps the second
+    if (ok) {
+        for (Prefab& prefab : parsed) {
+            assets.acquire(std::get<Sprite>(prefab.values).sheet);
+            assets.acquire(std::get<Animation>(prefab.values).sheet);
+        }
+    }
+    for (TextureHandle& handle : sheets)
+        assets.release(handle);
+    if (!ok)
+        return false;
+
+    clear();
+    prefabs = std::move(parsed);
+    for (size_t i = 0; i < prefabs.size(); ++i) {
+        if (!by_name.emplace(prefabs[i].name, (int)i).second)
+            TraceLog(LOG_WARNING, "%s: prefab %s is defined twice, the first one is used", source.c_str(), prefabs[i].name.c_str());
+    }
+    return true;
+}
+
+int PrefabLibrary::find(const std::string& name) const
+{
+    auto it = by_name.find(name);
+    return it != by_name.end() ? it->second : -1;
+}
+
+ComponentValues PrefabLibrary::make(int prefab, float x, float y, eZone zone) const
+{
+    ComponentValues values = prefabs[prefab].values;
+    Position& pos = std::get<Position>(values);
+    pos.x = x;
+    pos.y = y;
+    std::get<Hitbox>(values).rect = { x, y, TILE_WIDTH * pos.scale, TILE_WIDTH * pos.scale };
+    std::get<Zone>(values).zone = zone;
+    std::get<PrefabRef>(values).prefab = (uint32_t)prefab;
+    return values;
+}
+
+EntityHandle PrefabLibrary::instantiate(World& world, int prefab, int tileX, int tileY, eZone zone) const
+{
+    return world.create_from(prefabs[prefab].signature, make(prefab, (float)(tileX * TILE_WIDTH), (float)(tileY * TILE_HEIGHT), zone));
+}
+
+int PrefabLibrary::instantiate(World& world, const MapEntities& entities) const
+{
+    // Names are looked up once per map, not per placement
+    std::vector<int> resolved(entities.prefabs.size());
+    for (size_t i = 0; i < entities.prefabs.size(); ++i) {
+        resolved[i] = find(entities.prefabs[i]);
+        if (resolved[i] < 0)
+            TraceLog(LOG_WARNING, "Map places unknown prefab %s, skipped", entities.prefabs[i].c_str());
+    }
+
+    int made = 0;
+    for (const MapFileEntity& placed : entities.placed) {
+        // decode_map_file() and MapEntities::place() only let valid placements in, this is for hand-built ones
+        if (placed.prefab >= resolved.size() || placed.zone >= ZONE_COUNT)
+            continue;
+        int prefab = resolved[placed.prefab];
+        if (prefab < 0)
+            continue;
+        instantiate(world, prefab, placed.x, placed.y, (eZone)placed.zone);
+        made++;
+    }
+    return made;
+}
+
+void PrefabLibrary::draw_icon(int prefab, Rectangle dest, Color tint) const
+{
+    const Prefab& p = prefabs[prefab];
+    Rectangle src;
+    TextureHandle handle;
+    if (p.signature & COMPONENT_SPRITE) {
+        handle = std::get<Sprite>(p.values).sheet;
+        src = std::get<Sprite>(p.values).src;
+    } else if (p.signature & COMPONENT_ANIMATION) {
+        const Animation& anim = std::get<Animation>(p.values);
+        handle = anim.sheet;
+        src = { 0, 0, (float)(anim.size * anim.frame_span), (float)anim.size };
+    } else {
+        DrawRectangleRec(dest, Fade(tint, 0.5f));
+        return;
+    }
+
+    const AtlasSprite& sprite = assets.sprite(handle);
+    src.x += sprite.rect.x;
+    src.y += sprite.rect.y;
+    DrawTexturePro(sprite.texture, src, dest, { 0, 0 }, 0.0f, tint);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "map_format.h"
+#include "world.h"
+#include <raylib.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+Prefab files (*.prefabs) define entities as data, one block per prefab:
+
+    [name]
+    sprite <sheet> <x> <y> <w> <h>                                static frame, in sheet pixels
+    animation <sheet> <rows> <cols> <size> <frame time> [span]    same layout as SpriteAnimation
+    scale <tiles>
+    health <health> <damage> <points>
+    collider <prop|npc|trap|pickup> [blocking]
+    lifetime <seconds>
+    portal <zone> <zone>                                         zones are all, world or dungeon
+
+Sheets are paths under resources/. '#' starts a comment. Every prefab gets a
+Position, Hitbox, Zone and PrefabRef; the lines above add the other components.
+*/
+
+struct Prefab {
+    std::string name;
+    uint32_t signature = COMPONENT_POSITION | COMPONENT_HITBOX | COMPONENT_ZONE | COMPONENT_PREFAB;
+    ComponentValues values; // only those in signature are used
+};
+
+// Prefabs by name. Instances share the prefab's sheets, the library holds a reference to each.
+class PrefabLibrary {
+
+public:
+    PrefabLibrary() = default;
+    ~PrefabLibrary();
+
+    PrefabLibrary(const PrefabLibrary&) = delete;
+    PrefabLibrary& operator=(const PrefabLibrary&) = delete;
+
+    // Reads path from the asset pack or disk. On errors, logged with their line, the old prefabs are kept.
+    bool load(const std::string& path);
+    bool parse(const std::string& text, const std::string& source);
+    void clear();
+
+    // -1 when there is no such prefab
+    int find(const std::string& name) const;
+    size_t size() const { return prefabs.size(); }
+    const Prefab& operator[](size_t index) const { return prefabs[index]; }
+
+    // The components of one instance with its top-left corner at x, y (pixels)
+    ComponentValues make(int prefab, float x, float y, eZone zone) const;
+    EntityHandle instantiate(World& world, int prefab, int tileX, int tileY, eZone zone) const;
+    // Every placement of a map, in one pass. Placements of unknown prefabs are skipped, returns how many were made.
+    int instantiate(World& world, const MapEntities& entities) const;
+
+    // The prefab's sprite, or the first frame of its animation, stretched over dest
+    void draw_icon(int prefab, Rectangle dest, Color tint) const;
+
+private:
+    std::vector<Prefab> prefabs;
+    std::unordered_map<std::string, int> by_name;
+};
@@ -0,0 +1,73 @@
+#include "spatial_hash.h"
+#include <cmath>
+
+TileRect SpatialHash::cells_of(const Rectangle& box)
+{
+    // Zero sized boxes still occupy the cell they sit in
+    int x0 = (int)std::floor(box.x / TILE_WIDTH);
+    int y0 = (int)std::floor(box.y / TILE_HEIGHT);
+    int x1 = std::max(x0 + 1, (int)std::ceil((box.x + box.width) / TILE_WIDTH));
+    int y1 = std::max(y0 + 1, (int)std::ceil((box.y + box.height) / TILE_HEIGHT));
+    return { x0, y0, x1, y1 };
+}
+
+void SpatialHash::link(EntityHandle handle, const TileRect& r)
+{
+    for (int y = r.y0; y < r.y1; ++y) {
+        for (int x = r.x0; x < r.x1; ++x)
+            cells[cell_key(x, y)].push_back(handle);
+    }
+}
+
+void SpatialHash::unlink(EntityHandle handle, const TileRect& r)
+{
+    for (int y = r.y0; y < r.y1; ++y) {
+        for (int x = r.x0; x < r.x1; ++x) {
+            auto it = cells.find(cell_key(x, y));
+            if (it == cells.end())
+                continue;
+
+            std::vector<EntityHandle>& list = it->second;
+            auto at = std::find(list.begin(), list.end(), handle);
+            if (at != list.end()) {
+                *at = list.back();
+                list.pop_back();
+            }
+            if (list.empty())
+                cells.erase(it);
+        }
+    }
+}
+
+void SpatialHash::move(EntityHandle handle, const Rectangle& box)
+{
+    uint32_t index = handle.index();
+    if (index >= filed.size())
+        filed.resize(index + 1, TileRect {});
+
+    TileRect r = cells_of(box);
+    TileRect& old = filed[index];
+    if (r.x0 == old.x0 && r.y0 == old.y0 && r.x1 == old.x1 && r.y1 == old.y1)
+        return;
+
+    if (!old.empty())
+        unlink(handle, old);
+    link(handle, r);
+    old = r;
+}
+
+void SpatialHash::remove(EntityHandle handle)
+{
+    uint32_t index = handle.index();
+    if (index >= filed.size() || filed[index].empty())
+        return;
+
+    unlink(handle, filed[index]);
+    filed[index] = {};
+}
+
+void SpatialHash::clear()
+{
+    cells.clear();
+    filed.clear();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "entity_handle.h"
+#include "tile_grid.h"
+#include <algorithm>
+#include <cstdint>
+#include <raylib.h>
+#include <unordered_map>
+#include <vector>
+
+// Broadphase over entity hitboxes: every tile cell a hitbox touches lists the entity.
+// Queries only visit the cells they cover, so their cost follows how crowded that
+// part of the map is rather than how many entities exist. Candidates are only near
+// the query area, World tests them exactly against its HitboxStore.
+class SpatialHash {
+
+public:
+    // Files the entity under the cells box covers, re-filing it when they changed
+    void move(EntityHandle handle, const Rectangle& box);
+    void remove(EntityHandle handle);
+    void clear();
+
+    // fn(EntityHandle) once per entity filed in a cell that area touches, until fn returns false
+    template <typename Fn>
+    void visit(const Rectangle& area, Fn&& fn) const
+    {
+        TileRect r = cells_of(area);
+        for (int y = r.y0; y < r.y1; ++y) {
+            for (int x = r.x0; x < r.x1; ++x) {
+                auto it = cells.find(cell_key(x, y));
+                if (it == cells.end())
+                    continue;
+
+                for (EntityHandle handle : it->second) {
+                    // An entity spanning several cells is reported from the first one the query shares with it
+                    const TileRect& c = filed[handle.index()];
+                    if (x != std::max(r.x0, c.x0) || y != std::max(r.y0, c.y0))
+                        continue;
+                    if (!fn(handle))
+                        return;
+                }
+            }
+        }
+    }
+
+    size_t cell_count() const { return cells.size(); }
+
+private:
+    static TileRect cells_of(const Rectangle& box);
+    static uint64_t cell_key(int x, int y) { return TileGrid::chunk_key(x, y); }
+
+    void link(EntityHandle handle, const TileRect& r);
+    void unlink(EntityHandle handle, const TileRect& r);
+
+    std::unordered_map<uint64_t, std::vector<EntityHandle>> cells;
+    std::vector<TileRect> filed; // cells each entity is listed in, by EntityHandle::index(), empty when not filed
+};
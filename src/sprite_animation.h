@@ -1,5 +1,6 @@
 #pragma once
 
+#include "asset_manager.h"
 #include <raylib.h>
 
 enum class eDirection {
@@ -18,7 +19,7 @@ enum class eAnimType {
 
 class SpriteAnimation {
 public:
-    Texture2D texture;
+    TextureHandle sheet; // holds a reference, resolved to its atlas sprite when drawing
     int rows;
     int cols;
     int size;
@@ -36,7 +37,8 @@ public:
     bool finished; // true when non-looping animation reached last frame
 
     SpriteAnimation()
-        : rows(1)
+        : sheet {}
+        , rows(1)
         , cols(1)
         , size(0)
         , frameTime(0.2f)
@@ -51,9 +53,46 @@ public:
     {
     }
 
-    void init(Texture2D tex, int r, int c, int s, float ft, int span = 1, bool row_anim = true, bool loop = true)
+    SpriteAnimation(const SpriteAnimation& other)
+        : SpriteAnimation()
     {
-        texture = tex;
+        *this = other;
+    }
+
+    SpriteAnimation& operator=(const SpriteAnimation& other)
+    {
+        if (this == &other)
+            return *this;
+
+        assets.acquire(other.sheet);
+        assets.release(sheet);
+        sheet = other.sheet;
+        rows = other.rows;
+        cols = other.cols;
+        size = other.size;
+        frameTime = other.frameTime;
+        frame_span = other.frame_span;
+        row_based = other.row_based;
+        direction = other.direction;
+        animType = other.animType;
+        frame = other.frame;
+        timer = other.timer;
+        loop = other.loop;
+        finished = other.finished;
+        return *this;
+    }
+
+    ~SpriteAnimation()
+    {
+        assets.release(sheet);
+    }
+
+    // Takes its own reference to sheet_handle
+    void init(TextureHandle sheet_handle, int r, int c, int s, float ft, int span = 1, bool row_anim = true, bool loop = true)
+    {
+        assets.acquire(sheet_handle);
+        assets.release(sheet);
+        sheet = sheet_handle;
         rows = r;
         cols = c;
         size = s;
@@ -107,9 +146,10 @@ public:
             row = frame;
         }
 
+        const AtlasSprite& sprite = assets.sprite(sheet);
         Rectangle src = {
-            static_cast<float>((col * frame_span) * size),
-            static_cast<float>(row * size),
+            sprite.rect.x + static_cast<float>((col * frame_span) * size),
+            sprite.rect.y + static_cast<float>(row * size),
             (float)(frame_span * size),
             (float)size
         };
@@ -131,6 +171,6 @@ public:
             drawHeight
         };*/
 
-        DrawTexturePro(texture, src, dest, { 0, 0 }, 0.0f, WHITE);
+        DrawTexturePro(sprite.texture, src, dest, { 0, 0 }, 0.0f, WHITE);
     }
 };
@@ -0,0 +1,101 @@
+#include "systems.h"
+
+static bool in_zone(eZone entityZone, eZone zone)
+{
+    return entityZone == zone || entityZone == eZone::ALL;
+}
+
+void animate(World& world, float delta)
+{
+    world.each<Animation>([delta](EntityHandle, Animation& anim) {
+        anim.timer += delta;
+        if (anim.timer < anim.frame_time)
+            return;
+        anim.timer -= anim.frame_time;
+
+        int frameLimit = anim.row_based ? anim.cols : anim.rows;
+        if (++anim.frame >= frameLimit / anim.frame_span)
+            anim.frame = 0;
+    });
+}
+
+void expire(World& world, CommandBuffer& commands, float delta)
+{
+    world.each<Lifetime>([&](EntityHandle e, Lifetime& life) {
+        life.seconds -= delta;
+        if (life.seconds <= 0.0f)
+            commands.destroy(e);
+    });
+}
+
+void sync_hitboxes(World& world)
+{
+    world.each<Position, Hitbox>([&](EntityHandle e, const Position& t, Hitbox& box) {
+        Rectangle rect = { t.x, t.y, TILE_WIDTH * t.scale, TILE_WIDTH * t.scale };
+        if (rect.x == box.rect.x && rect.y == box.rect.y && rect.width == box.rect.width && rect.height == box.rect.height)
+            return;
+        // Only the indexes change, not the World's layout, so this is fine inside each()
+        box.rect = rect;
+        world.reindex(e);
+    });
+}
+
+bool blocked(World& world, const Rectangle& box, eZone zone, uint32_t mask)
+{
+    // Only entities filed in the cells box covers are tested, the first blocking one ends the search
+    HitboxFilter filter;
+    filter.zones = HitboxFilter::zone_bits(zone);
+    filter.layers = mask;
+    filter.flags = HITBOX_BLOCKING;
+    return world.any(box, filter);
+}
+
+void draw_animations(World& world, const Rectangle& view, eZone zone)
+{
+    world.each<Hitbox, Zone, Animation>([&](EntityHandle, const Hitbox& h, const Zone& z, const Animation& anim) {
+        if (!in_zone(z.zone, zone) || !CheckCollisionRecs(view, h.rect))
+            return;
+
+        // Same frame layout as SpriteAnimation::draw()
+        int dirIndex = static_cast<int>(anim.direction);
+        int row = anim.row_based ? (dirIndex < anim.rows ? dirIndex : 0) : anim.frame;
+        int col = anim.row_based ? anim.frame : (dirIndex < anim.cols ? dirIndex : 0);
+
+        const AtlasSprite& sprite = assets.sprite(anim.sheet);
+        Rectangle src = {
+            sprite.rect.x + (float)(col * anim.frame_span * anim.size),
+            sprite.rect.y + (float)(row * anim.size),
+            (float)(anim.frame_span * anim.size),
+            (float)anim.size
+        };
+        Rectangle dest = {
+            h.rect.x - (anim.frame_span - 1) * h.rect.width * 0.5f,
+            h.rect.y,
+            h.rect.width * anim.frame_span,
+            h.rect.height
+        };
+        DrawTexturePro(sprite.texture, src, dest, { 0, 0 }, 0.0f, WHITE);
+    });
+}
+
+void draw_sprites(World& world, const Rectangle& view, eZone zone)
+{
+    world.each<Hitbox, Zone, Sprite>([&](EntityHandle, const Hitbox& h, const Zone& z, const Sprite& s) {
+        if (!in_zone(z.zone, zone) || !CheckCollisionRecs(view, h.rect))
+            return;
+
+        const AtlasSprite& sprite = assets.sprite(s.sheet);
+        Rectangle src = { sprite.rect.x + s.src.x, sprite.rect.y + s.src.y, s.src.width, s.src.height };
+        DrawTexturePro(sprite.texture, src, h.rect, { 0, 0 }, 0.0f, WHITE);
+    });
+}
+
+void draw_hitboxes(World& world, const Rectangle& view, Color color)
+{
+    // One batched pass over the index instead of a rectangle test per entity
+    static std::vector<uint64_t> hits; // reused every frame
+    world.hitboxes.overlaps(view, HitboxFilter {}, hits);
+    HitboxStore::for_each_hit(hits, [&](uint32_t slot) {
+        DrawRectangleRec(world.hitboxes.rect(slot), Fade(color, 0.4f));
+    });
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "command_buffer.h"
+#include "world.h"
+#include <raylib.h>
+
+// Per-frame passes over World entities. Each one walks only the archetypes
+// that have the components it reads.
+
+// Animation: advances timers and frames
+void animate(World& world, float delta);
+// Lifetime: counts down, destroying the entities whose time is up
+void expire(World& world, CommandBuffer& commands, float delta);
+// Position -> Hitbox, for entities that have both. Those that moved are re-indexed.
+void sync_hitboxes(World& world);
+// Hitbox + Zone + Collider: true when box overlaps a blocking collider in zone
+// (or in every zone) whose layer is in mask. Only entities near box are tested.
+bool blocked(World& world, const Rectangle& box, eZone zone, uint32_t mask);
+// Hitbox + Zone + Animation: draws the current frame of the entities in zone whose hitbox is inside view
+void draw_animations(World& world, const Rectangle& view, eZone zone);
+// Hitbox + Zone + Sprite: same, for static frames
+void draw_sprites(World& world, const Rectangle& view, eZone zone);
+// Hitbox: debug outlines for every zone, found through world.hitboxes
+void draw_hitboxes(World& world, const Rectangle& view, Color color);
@@ -0,0 +1,155 @@
+#include "texture_atlas.h"
+#include <algorithm>
+#include <numeric>
+
+bool TextureAtlas::place(Page& page, int w, int h, Rectangle& out)
+{
+    int paddedW = w + PADDING;
+    int paddedH = h + PADDING;
+
+    // Reuse the tightest hole left by a removed sprite, handing back what's left to its right
+    int hole = -1;
+    for (int i = 0; i < (int)page.holes.size(); ++i) {
+        const Rectangle& r = page.holes[i];
+        if (r.width >= paddedW && r.height >= paddedH && (hole < 0 || r.width * r.height < page.holes[hole].width * page.holes[hole].height))
+            hole = i;
+    }
+    if (hole >= 0) {
+        Rectangle r = page.holes[hole];
+        page.holes.erase(page.holes.begin() + hole);
+        if (r.width - paddedW > PADDING)
+            page.holes.push_back({ r.x + paddedW, r.y, r.width - paddedW, r.height });
+        out = { r.x, r.y, (float)w, (float)h };
+        return true;
+    }
+
+    // Best fitting existing shelf: the one wasting the least height
+    Shelf* best = nullptr;
+    for (Shelf& shelf : page.shelves) {
+        if (shelf.height >= paddedH && shelf.cursor + paddedW <= page.width) {
+            if (!best || shelf.height < best->height)
+                best = &shelf;
+        }
+    }
+
+    // Open a new shelf below the last one
+    if (!best) {
+        if (page.top + paddedH > page.height || paddedW > page.width)
+            return false;
+        page.shelves.push_back({ page.top, paddedH, 0 });
+        page.top += paddedH;
+        best = &page.shelves.back();
+    }
+
+    out = { (float)best->cursor, (float)best->y, (float)w, (float)h };
+    best->cursor += paddedW;
+    return true;
+}
+
+int TextureAtlas::new_page(int w, int h)
+{
+    // Oversized images get a page of their own
+    Page page;
+    page.width = std::max(PAGE_SIZE, w + PADDING);
+    page.height = std::max(PAGE_SIZE, h + PADDING);
+
+    Image blank = GenImageColor(page.width, page.height, BLANK);
+    page.texture = LoadTextureFromImage(blank);
+    UnloadImage(blank);
+
+    // Slots of freed pages are reused so page indices stay small
+    int index = (int)pages.size();
+    for (int i = 0; i < (int)pages.size(); ++i) {
+        if (pages[i].texture.id == 0) {
+            index = i;
+            break;
+        }
+    }
+    if (index == (int)pages.size())
+        pages.push_back(page);
+    else
+        pages[index] = page;
+
+    TraceLog(LOG_INFO, "Atlas: page %d created (%dx%d)", index, page.width, page.height);
+    return index;
+}
+
+void TextureAtlas::remove(const AtlasSprite& sprite)
+{
+    if (sprite.page < 0 || sprite.page >= (int)pages.size())
+        return;
+
+    Page& page = pages[sprite.page];
+    if (page.texture.id == 0 || page.texture.id != sprite.texture.id)
+        return;
+
+    sprites--;
+    if (--page.used > 0) {
+        page.holes.push_back({ sprite.rect.x, sprite.rect.y, sprite.rect.width + PADDING, sprite.rect.height + PADDING });
+        return;
+    }
+
+    // Last sprite gone, give the memory back
+    UnloadTexture(page.texture);
+    page = Page {};
+    TraceLog(LOG_INFO, "Atlas: page %d released", sprite.page);
+}
+
+AtlasSprite TextureAtlas::add(Image& image)
+{
+    AtlasSprite sprite;
+    if (image.data == nullptr || image.width <= 0 || image.height <= 0)
+        return sprite;
+
+    if (image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+        ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+    Rectangle rect;
+    int pageIndex = -1;
+    for (int i = 0; i < (int)pages.size(); ++i) {
+        if (pages[i].texture.id != 0 && place(pages[i], image.width, image.height, rect)) {
+            pageIndex = i;
+            break;
+        }
+    }
+
+    if (pageIndex < 0) {
+        pageIndex = new_page(image.width, image.height);
+        if (!place(pages[pageIndex], image.width, image.height, rect))
+            return sprite;
+    }
+
+    Page& page = pages[pageIndex];
+    UpdateTextureRec(page.texture, rect, image.data);
+
+    sprite.texture = page.texture;
+    sprite.rect = rect;
+    sprite.page = pageIndex;
+    page.used++;
+    sprites++;
+    return sprite;
+}
+
+std::vector<AtlasSprite> TextureAtlas::add_all(std::vector<Image>& images)
+{
+    std::vector<size_t> order(images.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return images[a].height > images[b].height;
+    });
+
+    std::vector<AtlasSprite> result(images.size());
+    for (size_t i : order)
+        result[i] = add(images[i]);
+    return result;
+}
+
+void TextureAtlas::unload()
+{
+    for (Page& page : pages) {
+        if (page.texture.id != 0)
+            UnloadTexture(page.texture);
+    }
+    pages.clear();
+    sprites = 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <raylib.h>
+#include <vector>
+
+// An image packed into an atlas page: the page texture plus the image's pixel rect inside it
+struct AtlasSprite {
+    Texture2D texture = {}; // atlas page, shared with every other sprite on that page
+    Rectangle rect = {}; // pixels of this image inside the page
+    int page = -1;
+
+    int width() const { return (int)rect.width; }
+    int height() const { return (int)rect.height; }
+    bool valid() const { return page >= 0 && texture.id != 0; }
+
+    // Converts a rect in image space to page space
+    Rectangle source(Rectangle local) const
+    {
+        return { rect.x + local.x, rect.y + local.y, local.width, local.height };
+    }
+};
+
+// Packs tilesets and sprite sheets into a few large textures so drawing a
+// frame binds one or two textures instead of one per PNG. Images can be
+// added at any time (e.g. from the editor), pages are added as they fill up.
+// Sprites are owned by the AssetManager, which removes them when unused.
+class TextureAtlas {
+
+public:
+    static constexpr int PAGE_SIZE = 2048;
+    static constexpr int PADDING = 2; // empty pixels kept between packed images
+
+    // Packs a single image, converting it to RGBA8 if needed
+    AtlasSprite add(Image& image);
+    // Packs several images at once, tallest first, which wastes less space.
+    // Returns sprites in the same order as the input.
+    std::vector<AtlasSprite> add_all(std::vector<Image>& images);
+    // Frees the sprite's rect for reuse, the page texture is unloaded with its last sprite
+    void remove(const AtlasSprite& sprite);
+
+    int page_count() const { return (int)pages.size(); } // includes released slots
+    const Texture2D& page_texture(int page) const { return pages[page].texture; }
+    int sprite_count() const { return sprites; }
+
+    // Must run before the window closes
+    void unload();
+
+private:
+    struct Shelf {
+        int y;
+        int height;
+        int cursor; // next free x
+    };
+
+    struct Page {
+        Texture2D texture = {};
+        int width = 0;
+        int height = 0;
+        int top = 0; // y where the next shelf opens
+        int used = 0; // sprites on this page
+        std::vector<Shelf> shelves;
+        std::vector<Rectangle> holes; // rects of removed sprites, padding included
+    };
+
+    bool place(Page& page, int w, int h, Rectangle& out);
+    int new_page(int w, int h);
+
+    std::vector<Page> pages;
+    int sprites = 0;
+};
+
+// Backing store of every texture handed out by the AssetManager
+inline TextureAtlas texture_atlas;
@@ -1,12 +1,23 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <raylib.h>
+#include <unordered_map>
 
 constexpr int SCREEN_WIDTH = 1280;
 constexpr int SCREEN_HEIGHT = 720;
 
+// Default size of a new map, loaded maps carry their own dimensions
 constexpr int WORLD_WIDTH = 20;
 constexpr int WORLD_HEIGHT = 20;
 
+// Tiles per side of a TileGrid chunk
+constexpr int CHUNK_SIZE = 32;
+// Store chunk tiles in Z-order instead of row-major, so square neighbourhoods
+// share cache lines. Row-major keeps row scans (drawing, saving) sequential.
+constexpr bool CHUNK_MORTON_ORDER = false;
+
 constexpr int TILE_WIDTH = 16;
 constexpr int TILE_HEIGHT = 16;
 
@@ -15,8 +26,6 @@ typedef enum {
     // add more textures here if needed
 } eTexture_asset;
 
-#define MAX_TEXTURES 10
-
 enum class eTileType {
     FLOOR_0 = 0,
     FLOOR_1,
@@ -28,11 +37,23 @@ enum class eTileType {
     CHECK,
 };
 
+// Map layers, drawn bottom to top in this order
+enum eMapLayer {
+    LAYER_GROUND = 0,
+    LAYER_DECORATION,
+    LAYER_OVERHEAD, // drawn over the player and entities
+    LAYER_COLLISION, // painted cells block movement, only drawn in the editor and debug mode
+    LAYER_COUNT
+};
+
+inline const char* LAYER_NAMES[LAYER_COUNT] = { "Ground", "Decoration", "Overhead", "Collision" };
+
 enum class eZone {
     ALL = 0,
     WORLD,
     DUNGEON
 };
+constexpr int ZONE_COUNT = 3;
 
 /*struct Tile {
     int x;
@@ -40,9 +61,63 @@ enum class eZone {
     eTileType type;
 };*/
 
+// What a painted cell shows: a tile of one tileset
+struct TileKind {
+    int16_t type = -1; // tile index inside the tileset, -1 for empty
+    int16_t textureIndex = -1; // into Map::textures
+};
+
+// Process-wide table of every (type, textureIndex) pair in use, so a cell only
+// stores a 16-bit id. Entries are never changed or removed once added, so
+// reading an id found in a grid is safe from any thread.
+class TileTable {
+
+public:
+    static constexpr int CAPACITY = 1 << 16;
+
+    // Id of the pair, added on first use. 0 (the empty tile) for negative types or when the table is full.
+    uint16_t intern(int type, int textureIndex)
+    {
+        if (type < 0 || type > INT16_MAX || textureIndex < INT16_MIN || textureIndex > INT16_MAX)
+            return 0;
+
+        uint32_t key = (uint32_t)(uint16_t)type << 16 | (uint16_t)textureIndex;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = ids.find(key);
+        if (it != ids.end())
+            return it->second;
+
+        int id = count.load(std::memory_order_relaxed);
+        if (id >= CAPACITY) {
+            TraceLog(LOG_ERROR, "Tile table full, can't add tile %d of texture %d", type, textureIndex);
+            return 0;
+        }
+        kinds[id] = { (int16_t)type, (int16_t)textureIndex };
+        count.store(id + 1, std::memory_order_release);
+        ids.emplace(key, (uint16_t)id);
+        return (uint16_t)id;
+    }
+
+    const TileKind& operator[](uint16_t id) const { return kinds[id]; }
+    int size() const { return count.load(std::memory_order_acquire); }
+
+private:
+    std::mutex mutex;
+    std::unordered_map<uint32_t, uint16_t> ids;
+    std::atomic<int> count { 1 }; // id 0 is the empty tile
+    TileKind kinds[CAPACITY];
+};
+
+inline TileTable tile_table;
+
+// One map cell, its position is implied by where it is stored
 struct Tile {
-    int x;
-    int y;
-    int type = -1;
-    int textureIndex;
+    uint16_t id = 0; // into tile_table, 0 = empty
+    uint16_t flags = 0; // per-cell bits, none defined yet
+
+    bool empty() const { return id == 0; }
+    int type() const { return tile_table[id].type; }
+    int textureIndex() const { return tile_table[id].textureIndex; }
 };
+
+static_assert(sizeof(Tile) == 4, "tiles are meant to stay packed");
@@ -0,0 +1,82 @@
+#include "tile_batch.h"
+#include <rlgl.h>
+
+void TileBatch::new_frame()
+{
+    last = current;
+    current = {};
+}
+
+void TileBatch::add(int bucket, const Texture2D& tex, Rectangle source, Rectangle dest)
+{
+    if (bucket < 0 || tex.id == 0)
+        return;
+
+    if (bucket >= (int)buckets.size())
+        buckets.resize(bucket + 1);
+
+    Bucket& b = buckets[bucket];
+    if (b.textureId != tex.id && !b.quads.empty()) {
+        // The bucket was rebound to another texture mid-frame, submit what we have
+        flush();
+    }
+    b.textureId = tex.id;
+
+    float invW = 1.0f / (float)tex.width;
+    float invH = 1.0f / (float)tex.height;
+    b.quads.push_back({
+        dest.x,
+        dest.y,
+        dest.x + dest.width,
+        dest.y + dest.height,
+        source.x * invW,
+        source.y * invH,
+        (source.x + source.width) * invW,
+        (source.y + source.height) * invH,
+    });
+    pending++;
+}
+
+void TileBatch::flush(Color tint)
+{
+    if (pending == 0)
+        return;
+
+    // rlgl splits a draw when its vertex buffer fills up, count those as extra batches
+    const int quadsPerBuffer = RL_DEFAULT_BATCH_BUFFER_ELEMENTS;
+
+    for (Bucket& b : buckets) {
+        if (b.quads.empty())
+            continue;
+
+        rlSetTexture(b.textureId);
+        rlBegin(RL_QUADS);
+
+        rlColor4ub(tint.r, tint.g, tint.b, tint.a);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+
+        // Same winding as DrawTexturePro: top-left, bottom-left, bottom-right, top-right
+        for (const Quad& q : b.quads) {
+            rlTexCoord2f(q.u0, q.v0);
+            rlVertex2f(q.x0, q.y0);
+
+            rlTexCoord2f(q.u0, q.v1);
+            rlVertex2f(q.x0, q.y1);
+
+            rlTexCoord2f(q.u1, q.v1);
+            rlVertex2f(q.x1, q.y1);
+
+            rlTexCoord2f(q.u1, q.v0);
+            rlVertex2f(q.x1, q.y0);
+        }
+
+        rlEnd();
+        rlSetTexture(0);
+
+        current.quads += (int)b.quads.size();
+        current.batches += 1 + ((int)b.quads.size() - 1) / quadsPerBuffer;
+        b.quads.clear();
+    }
+
+    pending = 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <raylib.h>
+#include <vector>
+
+// Collects textured quads bucketed by texture and submits each bucket through
+// rlgl in one go, so neighbouring tiles from different tilesets don't force a
+// texture switch (and batch flush) per tile.
+class TileBatch {
+
+public:
+    struct Stats {
+        int quads = 0; // quads submitted
+        int batches = 0; // texture buckets submitted (one rlgl draw each, plus overflow splits)
+    };
+
+    // Per-frame counters: current accumulates, last holds the previous frame
+    Stats current;
+    Stats last;
+
+    // Start a new frame of counters
+    void new_frame();
+
+    // bucket is a small dense index (e.g. Map::textures index)
+    void add(int bucket, const Texture2D& tex, Rectangle source, Rectangle dest);
+    // Submit every bucket and clear them
+    void flush(Color tint = WHITE);
+
+    bool empty() const { return pending == 0; }
+
+private:
+    struct Quad {
+        float x0, y0, x1, y1; // screen-space corners
+        float u0, v0, u1, v1; // precomputed texture coordinates
+    };
+
+    struct Bucket {
+        unsigned int textureId = 0;
+        std::vector<Quad> quads;
+    };
+
+    std::vector<Bucket> buckets;
+    int pending = 0;
+};
@@ -0,0 +1,260 @@
+#include "tile_grid.h"
+#include <algorithm>
+#include <vector>
+
+static const Tile empty_tile = {};
+
+TileGrid::TileGrid(int w, int h)
+    : w(w)
+    , h(h)
+{
+}
+
+void TileGrid::reset(int width, int height)
+{
+    chunks.clear();
+    w = std::clamp(width, 1, MAP_MAX_SIZE);
+    h = std::clamp(height, 1, MAP_MAX_SIZE);
+    bump();
+}
+
+void TileGrid::resize(int width, int height)
+{
+    w = std::clamp(width, 1, MAP_MAX_SIZE);
+    h = std::clamp(height, 1, MAP_MAX_SIZE);
+    bump();
+
+    // Erase the part of each chunk that now falls outside the map
+    std::vector<uint64_t> dropped;
+    std::vector<uint64_t> clipped;
+    for (auto& [key, chunk] : chunks) {
+        int baseX = key_cx(key) * CHUNK_SIZE;
+        int baseY = key_cy(key) * CHUNK_SIZE;
+        if (baseX + CHUNK_SIZE > w || baseY + CHUNK_SIZE > h)
+            clipped.push_back(key);
+    }
+
+    for (uint64_t key : clipped) {
+        TileChunk* chunk = writable_chunk(key);
+        int baseX = key_cx(key) * CHUNK_SIZE;
+        int baseY = key_cy(key) * CHUNK_SIZE;
+
+        for (int ly = 0; ly < CHUNK_SIZE; ++ly) {
+            for (int lx = 0; lx < CHUNK_SIZE; ++lx) {
+                Tile& t = chunk->tiles[TileChunk::index(lx, ly)];
+                if (!t.empty() && !in_bounds(baseX + lx, baseY + ly)) {
+                    t = {};
+                    chunk->painted--;
+                }
+            }
+        }
+        touch(*chunk);
+        if (chunk->painted <= 0)
+            dropped.push_back(key);
+    }
+
+    for (uint64_t key : dropped)
+        chunks.erase(key);
+}
+
+void TileGrid::clear()
+{
+    chunks.clear();
+    bump();
+}
+
+TileGrid TileGrid::snapshot() const
+{
+    TileGrid copy(w, h);
+    copy.chunks = chunks;
+    copy.edits = edits;
+    return copy;
+}
+
+TileRect TileGrid::clamp(const TileRect& r) const
+{
+    return {
+        std::max(r.x0, 0),
+        std::max(r.y0, 0),
+        std::min(r.x1, w),
+        std::min(r.y1, h)
+    };
+}
+
+const TileChunk* TileGrid::find_chunk(int cx, int cy) const
+{
+    auto it = chunks.find(chunk_key(cx, cy));
+    return it != chunks.end() ? it->second.get() : nullptr;
+}
+
+TileChunk* TileGrid::writable_chunk(uint64_t key)
+{
+    auto it = chunks.find(key);
+    if (it == chunks.end())
+        return nullptr;
+
+    // Only this thread adds references, so a count of 1 can't grow under us
+    if (it->second.use_count() > 1)
+        it->second = std::make_shared<TileChunk>(*it->second);
+    return it->second.get();
+}
+
+TileChunk& TileGrid::get_or_create_chunk(int cx, int cy)
+{
+    uint64_t key = chunk_key(cx, cy);
+    if (TileChunk* chunk = writable_chunk(key))
+        return *chunk;
+
+    auto& slot = chunks[key];
+    slot = std::make_shared<TileChunk>();
+    return *slot;
+}
+
+void TileGrid::adopt(int cx, int cy, std::unique_ptr<TileChunk> chunk)
+{
+    int baseX = cx * CHUNK_SIZE;
+    int baseY = cy * CHUNK_SIZE;
+    bump();
+
+    chunk->painted = 0;
+    for (int ly = 0; ly < CHUNK_SIZE; ++ly) {
+        for (int lx = 0; lx < CHUNK_SIZE; ++lx) {
+            Tile& t = chunk->tiles[TileChunk::index(lx, ly)];
+            if (t.empty())
+                continue;
+            if (!in_bounds(baseX + lx, baseY + ly)) {
+                t = {};
+                continue;
+            }
+            chunk->painted++;
+        }
+    }
+
+    if (chunk->painted == 0) {
+        chunks.erase(chunk_key(cx, cy));
+        return;
+    }
+
+    touch(*chunk);
+    chunks[chunk_key(cx, cy)] = std::move(chunk);
+}
+
+void TileGrid::remap_ids(const std::vector<uint16_t>& table)
+{
+    bump();
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        TileChunk* chunk = writable_chunk(it->first);
+        chunk->painted = 0;
+        for (Tile& t : chunk->tiles) {
+            if (t.empty())
+                continue;
+            t.id = t.id < table.size() ? table[t.id] : 0;
+            if (!t.empty())
+                chunk->painted++;
+        }
+        touch(*chunk);
+        it = chunk->painted > 0 ? std::next(it) : chunks.erase(it);
+    }
+}
+
+const Tile& TileGrid::get(int x, int y) const
+{
+    if (!in_bounds(x, y))
+        return empty_tile;
+
+    const TileChunk* chunk = find_chunk(x / CHUNK_SIZE, y / CHUNK_SIZE);
+    if (!chunk)
+        return empty_tile;
+
+    return chunk->tiles[TileChunk::index(x % CHUNK_SIZE, y % CHUNK_SIZE)];
+}
+
+bool TileGrid::set(int x, int y, int type, int textureIndex)
+{
+    if (!in_bounds(x, y))
+        return false;
+
+    int cx = x / CHUNK_SIZE;
+    int cy = y / CHUNK_SIZE;
+    int local = TileChunk::index(x % CHUNK_SIZE, y % CHUNK_SIZE);
+
+    // Compare before touching anything so no-op strokes never unshare a chunk
+    uint16_t id = tile_table.intern(type, textureIndex);
+    if (get(x, y).id == id)
+        return false;
+    if (type >= 0 && id == 0)
+        return false; // table full
+
+    bump();
+
+    if (id == 0) {
+        // Erasing never allocates
+        uint64_t key = chunk_key(cx, cy);
+        TileChunk* chunk = writable_chunk(key);
+        chunk->tiles[local] = {};
+        touch(*chunk);
+        if (--chunk->painted <= 0)
+            chunks.erase(key);
+        return true;
+    }
+
+    TileChunk& chunk = get_or_create_chunk(cx, cy);
+    Tile& t = chunk.tiles[local];
+    if (t.empty())
+        chunk.painted++;
+    t.id = id;
+    touch(chunk);
+    return true;
+}
+
+bool TileGrid::filled_with(uint16_t id) const
+{
+    if ((int)chunks.size() != chunks_x() * chunks_y())
+        return false;
+
+    for (const auto& [key, chunk] : chunks) {
+        int maxX = std::min(CHUNK_SIZE, w - key_cx(key) * CHUNK_SIZE);
+        int maxY = std::min(CHUNK_SIZE, h - key_cy(key) * CHUNK_SIZE);
+        if (chunk->painted != maxX * maxY)
+            return false;
+        for (int ly = 0; ly < maxY; ++ly) {
+            for (int lx = 0; lx < maxX; ++lx) {
+                if (chunk->tiles[TileChunk::index(lx, ly)].id != id)
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool TileGrid::fill(int type, int textureIndex)
+{
+    if (type < 0) {
+        if (chunks.empty())
+            return false;
+        clear();
+        return true;
+    }
+
+    uint16_t id = tile_table.intern(type, textureIndex);
+    if (id == 0 || filled_with(id))
+        return false;
+
+    bump();
+    for (int cy = 0; cy < chunks_y(); ++cy) {
+        for (int cx = 0; cx < chunks_x(); ++cx) {
+            // Replace outright, a snapshot may still hold the old chunk
+            auto chunk = std::make_shared<TileChunk>();
+            int maxX = std::min(CHUNK_SIZE, w - cx * CHUNK_SIZE);
+            int maxY = std::min(CHUNK_SIZE, h - cy * CHUNK_SIZE);
+            chunk->painted = maxX * maxY;
+            for (int ly = 0; ly < maxY; ++ly) {
+                for (int lx = 0; lx < maxX; ++lx)
+                    chunk->tiles[TileChunk::index(lx, ly)].id = id;
+            }
+            touch(*chunk);
+            chunks[chunk_key(cx, cy)] = std::move(chunk);
+        }
+    }
+    return true;
+}
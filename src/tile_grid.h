@@ -0,0 +1,212 @@
+#pragma once
+
+#include "tile.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Half-open range of tile coordinates: [x0, x1) x [y0, y1)
+struct TileRect {
+    int x0, y0;
+    int x1, y1;
+
+    bool empty() const { return x1 <= x0 || y1 <= y0; }
+    int count() const { return empty() ? 0 : (x1 - x0) * (y1 - y0); }
+};
+
+static_assert((CHUNK_SIZE & (CHUNK_SIZE - 1)) == 0 && CHUNK_SIZE <= 256, "Z-order needs a power of two chunk size");
+
+constexpr int MAP_MAX_SIZE = 1 << 16; // tiles per side, grids are clamped to it and bigger map files rejected
+
+// Fixed-size square block of tiles, at tiles[index(lx, ly)]
+struct TileChunk {
+    Tile tiles[CHUNK_SIZE * CHUNK_SIZE];
+    int painted = 0; // non-empty cells, chunk is freed when this drops to 0
+    uint32_t revision = 0; // process-wide edit stamp of the last change, used to spot dirty chunks
+
+    static int index(int lx, int ly)
+    {
+        if (!CHUNK_MORTON_ORDER)
+            return ly * CHUNK_SIZE + lx;
+        return (int)(spread_bits((uint32_t)lx) | spread_bits((uint32_t)ly) << 1);
+    }
+
+private:
+    // abcd -> 0a0b0c0d
+    static uint32_t spread_bits(uint32_t v)
+    {
+        v = (v | v << 4) & 0x0f0fu;
+        v = (v | v << 2) & 0x3333u;
+        v = (v | v << 1) & 0x5555u;
+        return v;
+    }
+};
+
+// Sparse world storage: only chunks that contain painted tiles are allocated.
+// Dimensions are set at runtime (from the map file or the editor).
+// Chunks are shared copy-on-write, so snapshot() is O(chunks) and a snapshot
+// can be read on another thread while this grid keeps being edited.
+class TileGrid {
+
+public:
+    TileGrid(int w = WORLD_WIDTH, int h = WORLD_HEIGHT);
+
+    int width() const { return w; }
+    int height() const { return h; }
+    bool in_bounds(int x, int y) const { return x >= 0 && y >= 0 && x < w && y < h; }
+
+    // Drops every chunk and changes the dimensions
+    void reset(int width, int height);
+    // Keeps painted tiles that still fit inside the new bounds
+    void resize(int width, int height);
+    void clear();
+
+    // Read-only copy sharing every chunk with this grid
+    TileGrid snapshot() const;
+    // Changes on every edit and is never reused by another grid, to tell whether the map changed since a save
+    uint64_t version() const { return edits; }
+
+    // Read access never allocates, missing chunks read as an empty tile
+    const Tile& get(int x, int y) const;
+    // Returns true if the cell actually changed
+    bool set(int x, int y, int type, int textureIndex);
+    void erase(int x, int y) { set(x, y, -1, -1); }
+    // Paints every cell, false (and no new version) when they already all held that tile
+    bool fill(int type, int textureIndex);
+
+    // Installs a fully built chunk (e.g. decoded from a file), replacing any existing one.
+    // Painted count and revision are recomputed, empty chunks are dropped.
+    void adopt(int cx, int cy, std::unique_ptr<TileChunk> chunk);
+    // Rewrites every tile id through table (old id -> new id), ids past its end become empty
+    void remap_ids(const std::vector<uint16_t>& table);
+
+    const TileChunk* find_chunk(int cx, int cy) const;
+    size_t chunk_count() const { return chunks.size(); }
+    size_t memory_usage() const { return chunks.size() * sizeof(TileChunk); }
+
+    TileRect bounds() const { return { 0, 0, w, h }; }
+    TileRect clamp(const TileRect& r) const;
+
+    int chunks_x() const { return (w + CHUNK_SIZE - 1) / CHUNK_SIZE; }
+    int chunks_y() const { return (h + CHUNK_SIZE - 1) / CHUNK_SIZE; }
+
+    static uint64_t chunk_key(int cx, int cy)
+    {
+        return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+    }
+    static int key_cx(uint64_t key) { return (int)(uint32_t)(key >> 32); }
+    static int key_cy(uint64_t key) { return (int)(uint32_t)(key & 0xffffffffu); }
+
+    // fn(cx, cy, const TileChunk&) for every allocated chunk, in no particular order
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        for (const auto& [key, chunk] : chunks)
+            fn(key_cx(key), key_cy(key), *chunk);
+    }
+
+    // fn(x, y, const Tile&) for every painted tile inside area, skipping
+    // unallocated chunks entirely. Visits chunk by chunk, row by row within each.
+    template <typename Fn>
+    void for_each_in(const TileRect& area, Fn&& fn) const
+    {
+        TileRect r = clamp(area);
+        if (r.empty())
+            return;
+
+        for (int cy = r.y0 / CHUNK_SIZE; cy <= (r.y1 - 1) / CHUNK_SIZE; ++cy) {
+            for (int cx = r.x0 / CHUNK_SIZE; cx <= (r.x1 - 1) / CHUNK_SIZE; ++cx) {
+                const TileChunk* chunk = find_chunk(cx, cy);
+                if (!chunk)
+                    continue;
+
+                int baseX = cx * CHUNK_SIZE;
+                int baseY = cy * CHUNK_SIZE;
+                int lx0 = std::max(r.x0, baseX) - baseX;
+                int ly0 = std::max(r.y0, baseY) - baseY;
+                int lx1 = std::min(r.x1, baseX + CHUNK_SIZE) - baseX;
+                int ly1 = std::min(r.y1, baseY + CHUNK_SIZE) - baseY;
+
+                for (int ly = ly0; ly < ly1; ++ly) {
+                    for (int lx = lx0; lx < lx1; ++lx) {
+                        const Tile& t = chunk->tiles[TileChunk::index(lx, ly)];
+                        if (!t.empty())
+                            fn(baseX + lx, baseY + ly, t);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    TileChunk& get_or_create_chunk(int cx, int cy);
+    // Chunk safe to modify: cloned first when a snapshot still shares it
+    TileChunk* writable_chunk(uint64_t key);
+    // Every cell in bounds holds id
+    bool filled_with(uint16_t id) const;
+    // Revisions are unique across grids so a loaded grid never reuses a stamp a cache has seen
+    static void touch(TileChunk& chunk) { chunk.revision = ++edit_counter; }
+    void bump() { edits = ++version_counter; }
+
+    int w;
+    int h;
+    static inline std::atomic<uint32_t> edit_counter { 0 };
+    static inline std::atomic<uint64_t> version_counter { 0 };
+    uint64_t edits = 0;
+    std::unordered_map<uint64_t, std::shared_ptr<TileChunk>> chunks;
+};
+
+// One grid per eMapLayer, always the same size. Layers nobody painted hold no chunks.
+struct TileLayers {
+    std::array<TileGrid, LAYER_COUNT> grids;
+
+    TileGrid& operator[](int layer) { return grids[layer]; }
+    const TileGrid& operator[](int layer) const { return grids[layer]; }
+
+    int width() const { return grids[LAYER_GROUND].width(); }
+    int height() const { return grids[LAYER_GROUND].height(); }
+    bool in_bounds(int x, int y) const { return grids[LAYER_GROUND].in_bounds(x, y); }
+
+    void reset(int width, int height)
+    {
+        for (TileGrid& grid : grids)
+            grid.reset(width, height);
+    }
+    void resize(int width, int height)
+    {
+        for (TileGrid& grid : grids)
+            grid.resize(width, height);
+    }
+    void clear()
+    {
+        for (TileGrid& grid : grids)
+            grid.clear();
+    }
+
+    TileLayers snapshot() const
+    {
+        TileLayers copy;
+        for (int i = 0; i < LAYER_COUNT; ++i)
+            copy.grids[i] = grids[i].snapshot();
+        return copy;
+    }
+    // Versions are globally increasing, so the newest layer version changes on any edit
+    uint64_t version() const
+    {
+        uint64_t v = 0;
+        for (const TileGrid& grid : grids)
+            v = std::max(v, grid.version());
+        return v;
+    }
+    size_t chunk_count() const
+    {
+        size_t n = 0;
+        for (const TileGrid& grid : grids)
+            n += grid.chunk_count();
+        return n;
+    }
+};
@@ -0,0 +1,174 @@
+#include "world.h"
+
+World::~World()
+{
+    clear();
+}
+
+uint32_t World::allocate_slot()
+{
+    if (!free_slots.empty()) {
+        uint32_t index = free_slots.back();
+        free_slots.pop_back();
+        return index;
+    }
+    assert(slots.size() <= EntityHandle::INDEX_MASK && "Too many entities for EntityHandle");
+    slots.push_back({});
+    return (uint32_t)slots.size() - 1;
+}
+
+uint32_t World::archetype(uint32_t signature)
+{
+    auto it = by_signature.find(signature);
+    if (it != by_signature.end())
+        return it->second;
+
+    uint32_t at = (uint32_t)archetypes.size();
+    archetypes.emplace_back();
+    archetypes.back().signature = signature;
+    by_signature.emplace(signature, at);
+    return at;
+}
+
+void World::move_row(EntityHandle handle, uint32_t to)
+{
+    Slot& slot = slots[handle.index()];
+    uint32_t from = slot.archetype;
+    if (from == to)
+        return;
+
+    Archetype& src = archetypes[from];
+    Archetype& dst = archetypes[to];
+    uint32_t row = slot.row;
+    for_each_column(src.columns, [&](uint32_t bit, auto& column) {
+        if (src.signature & dst.signature & bit)
+            std::get<std::decay_t<decltype(column)>>(dst.columns).push_back(column[row]);
+    });
+    dst.handles.push_back(handle);
+
+    remove_row(from, row);
+    slot.archetype = to;
+    slot.row = (uint32_t)dst.size() - 1;
+}
+
+void World::remove_row(uint32_t at, uint32_t row)
+{
+    Archetype& arch = archetypes[at];
+    uint32_t last = (uint32_t)arch.size() - 1;
+    for_each_column(arch.columns, [&](uint32_t bit, auto& column) {
+        if (arch.signature & bit) {
+            column[row] = column[last];
+            column.pop_back();
+        }
+    });
+    if (row != last) {
+        arch.handles[row] = arch.handles[last];
+        slots[arch.handles[row].index()].row = row;
+    }
+    arch.handles.pop_back();
+}
+
+void World::destroy(EntityHandle handle)
+{
+    if (!alive(handle))
+        return;
+
+    spatial.remove(handle);
+    hitboxes.remove(handle);
+
+    Slot& slot = slots[handle.index()];
+    Archetype& arch = archetypes[slot.archetype];
+    for_each_column(arch.columns, [&](uint32_t bit, auto& column) {
+        if (arch.signature & bit)
+            component_removed(column[slot.row]);
+    });
+    remove_row(slot.archetype, slot.row);
+
+    slot.archetype = NONE;
+    slot.generation = EntityHandle::next_generation(slot.generation);
+    free_slots.push_back(handle.index());
+    live--;
+}
+
+void World::clear()
+{
+    spatial.clear();
+    hitboxes.clear();
+    for (Archetype& arch : archetypes) {
+        for_each_column(arch.columns, [&](uint32_t, auto& column) {
+            for (auto& component : column)
+                component_removed(component);
+            column.clear();
+        });
+        for (EntityHandle handle : arch.handles) {
+            Slot& slot = slots[handle.index()];
+            slot.archetype = NONE;
+            slot.generation = EntityHandle::next_generation(slot.generation);
+            free_slots.push_back(handle.index());
+        }
+        arch.handles.clear();
+    }
+    live = 0;
+}
+
+void World::reindex(EntityHandle handle)
+{
+    const Hitbox* box = get<Hitbox>(handle);
+    if (!box) {
+        spatial.remove(handle);
+        hitboxes.remove(handle);
+        return;
+    }
+
+    // Entities without a Collider are plain props that block nothing
+    const Zone* zone = get<Zone>(handle);
+    const Collider* collider = get<Collider>(handle);
+    uint32_t flags = HITBOX_ALIVE;
+    if (collider && collider->blocking)
+        flags |= HITBOX_BLOCKING;
+    hitboxes.update(handle, box->rect, zone ? zone->zone : eZone::ALL, collider ? collider->layer : (uint32_t)COLLIDE_PROP, flags);
+    spatial.move(handle, box->rect);
+}
+
+void World::query(const Rectangle& area, const HitboxFilter& filter, std::vector<EntityHandle>& out) const
+{
+    spatial.visit(area, [&](EntityHandle handle) {
+        if (hitboxes.overlaps(hitboxes.slot(handle), area, filter))
+            out.push_back(handle);
+        return true;
+    });
+}
+
+bool World::any(const Rectangle& area, const HitboxFilter& filter) const
+{
+    bool hit = false;
+    spatial.visit(area, [&](EntityHandle handle) {
+        hit = hitboxes.overlaps(hitboxes.slot(handle), area, filter);
+        return !hit;
+    });
+    return hit;
+}
+
+void World::query_radius(Vector2 center, float radius, const HitboxFilter& filter, std::vector<EntityHandle>& out) const
+{
+    Rectangle bounds = { center.x - radius, center.y - radius, radius * 2, radius * 2 };
+    spatial.visit(bounds, [&](EntityHandle handle) {
+        uint32_t slot = hitboxes.slot(handle);
+        if (hitboxes.passes(slot, filter) && CheckCollisionCircleRec(center, radius, hitboxes.rect(slot)))
+            out.push_back(handle);
+        return true;
+    });
+}
+
+EntityHandle World::pick(Vector2 point, const HitboxFilter& filter) const
+{
+    EntityHandle picked;
+    spatial.visit({ point.x, point.y, 0, 0 }, [&](EntityHandle handle) {
+        uint32_t slot = hitboxes.slot(handle);
+        if (!hitboxes.passes(slot, filter) || !CheckCollisionPointRec(point, hitboxes.rect(slot)))
+            return true;
+        picked = handle;
+        return false;
+    });
+    return picked;
+}
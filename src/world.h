@@ -0,0 +1,247 @@
+#pragma once
+
+#include "components.h"
+#include "entity_handle.h"
+#include "hitbox_store.h"
+#include "spatial_hash.h"
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Entities as sets of components (see components.h), stored by archetype: all entities with
+// exactly the same components share one Archetype, which keeps every component type in its own
+// dense array. Systems walk only the archetypes that have what they need, array by array, with
+// no virtual calls. Adding or removing a component moves the entity's row to another archetype.
+//
+// Nothing may be created, destroyed, added or removed while each() is running, changing
+// components that are already there is fine. Record those changes in a CommandBuffer instead.
+//
+// Entities with a Hitbox are also indexed by area (spatial, hitboxes), so queries near a point
+// don't walk every entity. create(), set() and remove() keep the indexes current, code that writes
+// a Hitbox, Zone or Collider through get() calls reindex() afterwards.
+class World {
+
+public:
+    struct Archetype {
+        uint32_t signature = 0; // eComponent bits
+        std::vector<EntityHandle> handles; // per row
+        ComponentColumns columns; // only the columns in signature are used
+
+        template <typename C>
+        std::vector<C>& column() { return std::get<std::vector<C>>(columns); }
+        size_t size() const { return handles.size(); }
+    };
+
+    // Every entity with a Hitbox, by the cells it covers
+    SpatialHash spatial;
+    // Every entity with a Hitbox, for batched overlap tests over large areas
+    HitboxStore hitboxes;
+
+    World() = default;
+    ~World();
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    template <typename... C>
+    EntityHandle create(const C&... components)
+    {
+        EntityHandle handle = reserve();
+        create_reserved(handle, components...);
+        return handle;
+    }
+    // Handle of an entity that create_reserved() makes later. Unlike create() this is safe
+    // inside each(), the entity doesn't exist (alive() is false) until then.
+    EntityHandle reserve()
+    {
+        uint32_t index = allocate_slot();
+        return EntityHandle::make(index, slots[index].generation);
+    }
+    template <typename... C>
+    void create_reserved(EntityHandle handle, const C&... components)
+    {
+        Slot& slot = slots[handle.index()];
+        assert(slot.archetype == NONE && slot.generation == handle.generation() && "Handle wasn't reserved");
+        uint32_t at = archetype((0 | ... | component_bit<C>()));
+        Archetype& arch = archetypes[at];
+        slot.archetype = at;
+        slot.row = (uint32_t)arch.size();
+        arch.handles.push_back(handle);
+        (add(arch.column<C>(), components), ...);
+        live++;
+        if (arch.signature & COMPONENT_HITBOX)
+            reindex(handle);
+    }
+    // Entity with the components of values whose bits are in signature, for sets chosen at run time
+    EntityHandle create_from(uint32_t signature, const ComponentValues& values)
+    {
+        EntityHandle handle = reserve();
+        create_reserved_from(handle, signature, values);
+        return handle;
+    }
+    void create_reserved_from(EntityHandle handle, uint32_t signature, const ComponentValues& values)
+    {
+        Slot& slot = slots[handle.index()];
+        assert(slot.archetype == NONE && slot.generation == handle.generation() && "Handle wasn't reserved");
+        uint32_t at = archetype(signature);
+        Archetype& arch = archetypes[at];
+        slot.archetype = at;
+        slot.row = (uint32_t)arch.size();
+        arch.handles.push_back(handle);
+        add_values(arch, values, std::make_index_sequence<COMPONENT_COUNT>());
+        live++;
+        if (arch.signature & COMPONENT_HITBOX)
+            reindex(handle);
+    }
+    void destroy(EntityHandle handle);
+    // Destroys every entity
+    void clear();
+
+    bool alive(EntityHandle handle) const
+    {
+        uint32_t index = handle.index();
+        return handle && index < slots.size() && slots[index].archetype != NONE && slots[index].generation == handle.generation();
+    }
+
+    // nullptr when the entity is gone or doesn't have a C
+    template <typename C>
+    C* get(EntityHandle handle)
+    {
+        if (!alive(handle))
+            return nullptr;
+        const Slot& slot = slots[handle.index()];
+        Archetype& arch = archetypes[slot.archetype];
+        return (arch.signature & component_bit<C>()) ? &arch.column<C>()[slot.row] : nullptr;
+    }
+
+    // Replaces the entity's C, or adds it
+    template <typename C>
+    void set(EntityHandle handle, const C& component)
+    {
+        if (C* existing = get<C>(handle)) {
+            C old = *existing;
+            *existing = component;
+            component_added(*existing);
+            component_removed(old);
+        } else {
+            if (!alive(handle))
+                return;
+            Slot& slot = slots[handle.index()];
+            uint32_t to = archetype(archetypes[slot.archetype].signature | component_bit<C>());
+            move_row(handle, to);
+            add(archetypes[to].column<C>(), component);
+        }
+        if constexpr ((component_bit<C>() & INDEXED) != 0)
+            reindex(handle);
+    }
+
+    template <typename C>
+    void remove(EntityHandle handle)
+    {
+        C* existing = get<C>(handle);
+        if (!existing)
+            return;
+        component_removed(*existing);
+        move_row(handle, archetype(archetypes[slots[handle.index()].archetype].signature & ~component_bit<C>()));
+        if constexpr ((component_bit<C>() & INDEXED) != 0)
+            reindex(handle);
+    }
+
+    // Copies the entity's Hitbox, Zone and Collider into the indexes, or drops it when it has no Hitbox
+    void reindex(EntityHandle handle);
+
+    // Entities whose hitbox overlaps area and passes filter, from the cells area covers
+    void query(const Rectangle& area, const HitboxFilter& filter, std::vector<EntityHandle>& out) const;
+    // Whether any entity's hitbox overlaps area and passes filter, stops at the first one
+    bool any(const Rectangle& area, const HitboxFilter& filter) const;
+    // Entities whose hitbox touches the circle and passes filter, from the cells its bounding square covers
+    void query_radius(Vector2 center, float radius, const HitboxFilter& filter, std::vector<EntityHandle>& out) const;
+    // An entity whose hitbox contains point, an invalid handle if none
+    EntityHandle pick(Vector2 point, const HitboxFilter& filter) const;
+
+    // fn(EntityHandle, C&...) for every entity that has all of C. When fn returns bool, false stops the walk.
+    template <typename... C, typename Fn>
+    void each(Fn&& fn)
+    {
+        const uint32_t needed = (0 | ... | component_bit<C>());
+        for (Archetype& arch : archetypes) {
+            if ((arch.signature & needed) != needed || arch.size() == 0)
+                continue;
+            if (!each_row(arch, fn, arch.column<C>()...))
+                return;
+        }
+    }
+
+    size_t size() const { return live; }
+    size_t archetype_count() const { return archetypes.size(); }
+
+private:
+    static constexpr uint32_t NONE = 0xffffffffu;
+    // Components that change what the indexes hold
+    static constexpr uint32_t INDEXED = COMPONENT_HITBOX | COMPONENT_ZONE | COMPONENT_COLLIDER;
+
+    struct Slot {
+        uint32_t generation = 1;
+        uint32_t archetype = NONE; // NONE while the slot is free
+        uint32_t row = 0;
+    };
+
+    template <typename C>
+    static void add(std::vector<C>& column, const C& component)
+    {
+        column.push_back(component);
+        component_added(column.back());
+    }
+
+    template <size_t... I>
+    static void add_values(Archetype& arch, const ComponentValues& values, std::index_sequence<I...>)
+    {
+        ((arch.signature & (1u << I) ? add(std::get<I>(arch.columns), std::get<I>(values)) : void()), ...);
+    }
+
+    // False when fn asked to stop
+    template <typename Fn, typename... Columns>
+    static bool each_row(Archetype& arch, Fn& fn, Columns&... columns)
+    {
+        const EntityHandle* handles = arch.handles.data();
+        size_t count = arch.size();
+        for (size_t row = 0; row < count; ++row) {
+            if constexpr (std::is_same<decltype(fn(handles[row], columns[row]...)), bool>::value) {
+                if (!fn(handles[row], columns[row]...))
+                    return false;
+            } else {
+                fn(handles[row], columns[row]...);
+            }
+        }
+        return true;
+    }
+
+    // fn(bit, column) for every component type
+    template <typename Fn, size_t... I>
+    static void for_each_column(ComponentColumns& columns, Fn&& fn, std::index_sequence<I...>)
+    {
+        (fn(1u << I, std::get<I>(columns)), ...);
+    }
+    template <typename Fn>
+    static void for_each_column(ComponentColumns& columns, Fn&& fn)
+    {
+        for_each_column(columns, fn, std::make_index_sequence<COMPONENT_COUNT>());
+    }
+
+    uint32_t allocate_slot();
+    // Index of the archetype with exactly signature, made on first use
+    uint32_t archetype(uint32_t signature);
+    // Moves the entity to archetype to, keeping the components both have
+    void move_row(EntityHandle handle, uint32_t to);
+    // Fills row with the last one, without calling component_removed()
+    void remove_row(uint32_t at, uint32_t row);
+
+    std::vector<Archetype> archetypes;
+    std::unordered_map<uint32_t, uint32_t> by_signature;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+    size_t live = 0;
+};
@@ -0,0 +1,127 @@
+// Cooks a resources/ folder into a single asset pack the game maps at startup.
+//
+//     cook <resources dir> <output.pak>
+//
+// Textures are decoded to RGBA8, maps have their texture names replaced by
+// content ids (so they no longer depend on where resources/ lived when they
+// were saved), sounds and prefab files are stored as is. See asset_pack.h for the layout.
+
+#include "asset_pack.h"
+#include "map_format.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <raylib.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::vector<uint8_t> read_file(const fs::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: %s <resources dir> <output.pak>\n", argv[0]);
+        return 2;
+    }
+    SetTraceLogLevel(LOG_WARNING);
+    auto start = std::chrono::steady_clock::now();
+
+    fs::path root = argv[1];
+    std::error_code ec;
+    std::vector<fs::path> textures, maps, sounds, data;
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (!it->is_regular_file())
+            continue;
+        std::string ext = it->path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (ext == ".png")
+            textures.push_back(it->path());
+        else if (ext == ".bin")
+            maps.push_back(it->path());
+        else if (ext == ".wav" || ext == ".ogg" || ext == ".mp3")
+            sounds.push_back(it->path());
+        else if (ext == ".prefabs")
+            data.push_back(it->path());
+        // journals, autosaves and anything else stay out
+    }
+    if (ec) {
+        std::fprintf(stderr, "cook: can't read %s\n", root.string().c_str());
+        return 1;
+    }
+
+    // Sorted so the same tree always cooks to the same pack
+    for (auto* list : { &textures, &maps, &sounds, &data })
+        std::sort(list->begin(), list->end());
+
+    auto name_of = [&](const fs::path& path) { return path.lexically_relative(root).generic_string(); };
+
+    PakBuilder pak;
+    std::unordered_map<std::string, uint64_t> textureIds; // name -> content id
+    int failed = 0;
+
+    for (const fs::path& path : textures) {
+        Image image = LoadImage(path.string().c_str());
+        if (image.data == nullptr) {
+            std::fprintf(stderr, "cook: can't decode %s\n", path.string().c_str());
+            failed++;
+            continue;
+        }
+        ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+        const uint8_t* pixels = (const uint8_t*)image.data;
+        std::vector<uint8_t> bytes(pixels, pixels + (size_t)image.width * image.height * 4);
+        std::string name = name_of(path);
+        textureIds[name] = pak.add(name, PAK_TEXTURE, std::move(bytes), image.width, image.height);
+        UnloadImage(image);
+    }
+
+    for (const fs::path& path : maps) {
+        MapFileContents contents;
+        if (!read_map_file(path.string(), contents)) {
+            std::fprintf(stderr, "cook: can't read map %s\n", path.string().c_str());
+            failed++;
+            continue;
+        }
+
+        for (std::string& texture : contents.textures) {
+            auto it = textureIds.find(resource_name(texture));
+            if (it == textureIds.end()) {
+                std::fprintf(stderr, "cook: %s uses %s, which isn't under %s\n", path.string().c_str(), texture.c_str(), root.string().c_str());
+                failed++;
+                continue;
+            }
+            texture = content_ref(it->second);
+        }
+        // The file's own texture indexes, encoded again against the same (renamed) table
+        std::vector<int> sameTextures(contents.textures.size());
+        for (size_t i = 0; i < sameTextures.size(); ++i)
+            sameTextures[i] = (int)i;
+        contents.resolve_tiles(sameTextures);
+        pak.add(name_of(path), PAK_MAP, encode_map_file(contents.layers, contents.textures, contents.entities));
+    }
+
+    for (const fs::path& path : sounds)
+        pak.add(name_of(path), PAK_SOUND, read_file(path));
+    for (const fs::path& path : data)
+        pak.add(name_of(path), PAK_DATA, read_file(path));
+
+    if (failed > 0) {
+        std::fprintf(stderr, "cook: %d assets failed, %s not written\n", failed, argv[2]);
+        return 1;
+    }
+    if (!pak.write(argv[2]))
+        return 1;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("cook: %zu textures, %zu maps, %zu sounds, %zu data files -> %s (%.1f MB, %.2fs)\n",
+        textures.size(), maps.size(), sounds.size(), data.size(), argv[2], pak.stored_bytes() / (1024.0 * 1024.0), seconds);
+    return 0;
+}